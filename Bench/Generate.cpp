@@ -0,0 +1,117 @@
+// Writes large synthetic images for the benchmarks with libjpeg, so they do not
+// have to be kept in the repository.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+// jpeglib.h needs size_t and FILE declared before it.
+#include <jpeglib.h>
+
+namespace
+{
+
+struct Variant
+{
+    std::string name;
+    int         components;
+    // Horizontal and vertical sampling factors of luma, chroma ones are 1.
+    int         h_sampling;
+    int         v_sampling;
+    int         quality;
+    bool        progressive;
+    int         restart_rows;
+};
+
+const size_t kWidth  = 4096;
+const size_t kHeight = 3072;
+
+// Smooth gradients and waves with some noise, so blocks have a mix of low and
+// high frequencies like photos do.
+std::vector<uint8_t> MakePixels(int components)
+{
+    std::vector<uint8_t> pixels(kWidth * kHeight * components);
+    uint32_t             state = 12345;
+    for (size_t y = 0; y < kHeight; ++y)
+    {
+        for (size_t x = 0; x < kWidth; ++x)
+        {
+            state      = state * 1664525 + 1013904223;
+            int noise  = static_cast<int>(state >> 28) - 8;
+            double fx  = static_cast<double>(x) / kWidth;
+            double fy  = static_cast<double>(y) / kHeight;
+            double wave = 40 * std::sin(x * 0.05 + std::sin(y * 0.01) * 6) * std::cos(y * 0.03);
+            int base[3] = {static_cast<int>(255 * fx + wave), static_cast<int>(255 * fy - wave),
+                           static_cast<int>(128 + 100 * std::sin((fx + fy) * 9))};
+            for (int c = 0; c < components; ++c)
+            {
+                int value = base[c] + noise;
+                pixels[(y * kWidth + x) * components + c] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+            }
+        }
+    }
+    return pixels;
+}
+
+void Write(const std::string& path, const Variant& variant, const std::vector<uint8_t>& pixels)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error("can't open " + path);
+    }
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr       err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, file);
+
+    cinfo.image_width      = kWidth;
+    cinfo.image_height     = kHeight;
+    cinfo.input_components = variant.components;
+    cinfo.in_color_space   = variant.components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, variant.quality, static_cast<boolean>(true));
+    cinfo.comp_info[0].h_samp_factor = variant.h_sampling;
+    cinfo.comp_info[0].v_samp_factor = variant.v_sampling;
+    cinfo.restart_in_rows            = variant.restart_rows;
+    if (variant.progressive)
+    {
+        jpeg_simple_progression(&cinfo);
+    }
+    jpeg_start_compress(&cinfo, static_cast<boolean>(true));
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+        JSAMPROW row = const_cast<uint8_t*>(pixels.data()) + cinfo.next_scanline * kWidth * variant.components;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    fclose(file);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <output directory>\n", argv[0]);
+        return 1;
+    }
+    const std::vector<Variant> variants = {
+        {        "synthetic_420", 3, 2, 2, 85, false, 0},
+        {        "synthetic_444", 3, 1, 1, 95, false, 0},
+        {       "synthetic_gray", 1, 1, 1, 90, false, 0},
+        {"synthetic_progressive", 3, 2, 2, 85,  true, 0},
+        {    "synthetic_restart", 3, 2, 2, 85, false, 1},
+    };
+    std::vector<uint8_t> color = MakePixels(3);
+    std::vector<uint8_t> gray  = MakePixels(1);
+    for (const auto& variant : variants)
+    {
+        Write(std::string(argv[1]) + "/" + variant.name + ".jpg", variant, variant.components == 1 ? gray : color);
+    }
+}
@@ -0,0 +1,400 @@
+// Benchmarks of the decoder stages and of whole decodes next to libjpeg. Rates
+// are reported as MB/s of the data a stage consumes (compressed bytes for whole
+// decodes) and megapixels (or million samples) per second.
+#include "Decoder.h"
+#include "IDCT.h"
+#include "Upsample.h"
+#include "ColorConvert.h"
+#include "MCUReader.h"
+#include <benchmark/benchmark.h>
+#include <jpeglib.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+
+const std::string kImageDir      = IMAGE_DIR;
+const std::string kBenchImageDir = BENCH_IMAGE_DIR;
+
+void SetRates(benchmark::State& state, size_t bytes, size_t pixels)
+{
+    double iterations = static_cast<double>(state.iterations());
+    // Rates are shown with a /s suffix.
+    state.counters["MB"] = benchmark::Counter(bytes * iterations / 1e6, benchmark::Counter::kIsRate);
+    if (pixels)
+    {
+        state.counters["Mpix"] = benchmark::Counter(pixels * iterations / 1e6, benchmark::Counter::kIsRate);
+    }
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+//___Bits and Huffman codes____________________________________________________________________________________________________
+
+// Random bytes without markers, 0xff is followed by a stuffed zero.
+std::vector<uint8_t> RandomEntropyData(size_t size)
+{
+    std::mt19937         random(1);
+    std::vector<uint8_t> data;
+    while (data.size() < size)
+    {
+        data.push_back(random() & 0xff);
+        if (data.back() == 0xff)
+        {
+            data.push_back(0);
+        }
+    }
+    return data;
+}
+
+void BM_BitReader(benchmark::State& state)
+{
+    std::vector<uint8_t> data = RandomEntropyData(1 << 20);
+    size_t               bits = 0;
+    for (auto _ : state)
+    {
+        BitReader reader{StreamNavigator(std::span<const uint8_t>(data))};
+        bits = 0;
+        // Lengths of codes and magnitudes alternate between short and long ones.
+        for (size_t count = 1; bits + 32 < data.size() * 7; count = count % 16 + 1)
+        {
+            benchmark::DoNotOptimize(reader.ReadBits(count));
+            bits += count;
+        }
+    }
+    SetRates(state, bits / 8, 0);
+}
+BENCHMARK(BM_BitReader);
+
+// The first AC table of a real image and a stream of its codes, which are
+// distributed like the code lengths imply.
+struct HuffmanStream
+{
+    HuffmanTree          tree;
+    std::vector<uint8_t> data;
+    size_t               symbols = 0;
+};
+
+HuffmanStream MakeHuffmanStream(size_t symbols)
+{
+    std::vector<uint8_t> file = ReadFile(kImageDir + "lenna.jpg");
+    size_t               pos  = 0;
+    while (!(file[pos] == 0xff && file[pos + 1] == 0xc4 && (file[pos + 4] >> 4) == 1))
+    {
+        ++pos;
+    }
+    std::span<const uint8_t> counts(file.data() + pos + 5, 16);
+    size_t                   values_count = 0;
+    for (auto count : counts)
+    {
+        values_count += count;
+    }
+    std::span<const uint8_t> values(file.data() + pos + 21, values_count);
+
+    HuffmanStream stream;
+    stream.tree.Build(counts, values);
+    stream.symbols = symbols;
+
+    // Canonical codes of the symbols by length.
+    std::vector<std::vector<uint32_t>> codes(17);
+    uint32_t                           code = 0;
+    for (size_t length = 1; length <= 16; ++length, code <<= 1)
+    {
+        for (size_t i = 0; i < counts[length - 1]; ++i)
+        {
+            codes[length].push_back(code++);
+        }
+    }
+    std::mt19937 random(2);
+    uint64_t     buffer = 0;
+    size_t       bits   = 0;
+    auto         flush  = [&]() {
+        while (bits >= 8)
+        {
+            uint8_t byte = (buffer >> (bits - 8)) & 0xff;
+            stream.data.push_back(byte);
+            if (byte == 0xff)
+            {
+                stream.data.push_back(0);
+            }
+            bits -= 8;
+        }
+    };
+    for (size_t i = 0; i < symbols; ++i)
+    {
+        // A code of length l comes with probability 2^-l.
+        size_t length = 1;
+        while (length < 16 && (codes[length].empty() || (random() & 1)))
+        {
+            ++length;
+        }
+        if (codes[length].empty())
+        {
+            --i;
+            continue;
+        }
+        buffer = (buffer << length) | codes[length][random() % codes[length].size()];
+        bits += length;
+        flush();
+    }
+    buffer = (buffer << 16) | 0xffff;
+    bits += 16;
+    flush();
+    return stream;
+}
+
+void BM_HuffmanDecode(benchmark::State& state)
+{
+    HuffmanStream stream = MakeHuffmanStream(1 << 20);
+    for (auto _ : state)
+    {
+        BitReader reader{StreamNavigator(std::span<const uint8_t>(stream.data))};
+        for (size_t i = 0; i < stream.symbols; ++i)
+        {
+            int value;
+            reader.Consume(stream.tree.Decode(reader.Peek(16), value));
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * stream.symbols);
+    SetRates(state, stream.data.size(), 0);
+}
+BENCHMARK(BM_HuffmanDecode);
+
+//___Transforms and color______________________________________________________________________________________________________
+
+const size_t kBlocks   = 4096;
+const size_t kRowWidth = 4096;
+
+// Blocks with a DC and a few low frequencies, like those of a photo.
+std::vector<int16_t> RandomBlocks()
+{
+    std::mt19937         random(3);
+    std::vector<int16_t> blocks(kBlocks * 64, 0);
+    for (size_t i = 0; i < kBlocks; ++i)
+    {
+        blocks[i * 64] = static_cast<int16_t>(random() % 1024) - 512;
+        for (size_t k = 0; k < 10; ++k)
+        {
+            size_t x                   = random() % 4;
+            size_t y                   = random() % 4;
+            blocks[i * 64 + y * 8 + x] = static_cast<int16_t>(random() % 61) - 30;
+        }
+    }
+    return blocks;
+}
+
+// Full, low frequency or DC only transform of a backend. Random blocks have
+// their coefficients in the top left 4x4 corner, the DC only one reads just the DC.
+using InverseMethod = void (IDCTBackend::*)(const int16_t*, const uint16_t*, uint8_t*, size_t) const;
+
+void BM_IDCT(benchmark::State& state, IDCTBackendType type, InverseMethod method)
+{
+    const IDCTBackend*       backend = GetIDCTBackend(type);
+    std::vector<int16_t>     blocks  = RandomBlocks();
+    std::array<uint16_t, 64> quant;
+    quant.fill(2);
+    std::vector<uint8_t> output(kBlocks * 64);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < kBlocks; ++i)
+        {
+            (backend->*method)(blocks.data() + i * 64, quant.data(), output.data() + i * 64, 8);
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetRates(state, blocks.size() * sizeof(int16_t), output.size());
+}
+
+void BM_IDCTReduced(benchmark::State& state)
+{
+    size_t                   size   = state.range(0);
+    std::vector<int16_t>     blocks = RandomBlocks();
+    std::array<uint16_t, 64> quant;
+    quant.fill(2);
+    std::vector<uint8_t> output(kBlocks * size * size);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < kBlocks; ++i)
+        {
+            InverseReduced(blocks.data() + i * 64, quant.data(), output.data() + i * size * size, size, size);
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetRates(state, blocks.size() * sizeof(int16_t), output.size());
+}
+BENCHMARK(BM_IDCTReduced)->Arg(4)->Arg(2)->Arg(1);
+
+std::vector<uint8_t> RandomRow(size_t width, uint32_t seed)
+{
+    std::mt19937         random(seed);
+    std::vector<uint8_t> row(width);
+    for (auto& sample : row)
+    {
+        sample = random() & 0xff;
+    }
+    return row;
+}
+
+// Upsamples a chroma row of a kRowWidth wide image, rates are of output samples.
+using UpsampleKernel = std::function<void(const uint8_t* nearest, const uint8_t* farthest, uint8_t* output)>;
+
+void BM_Upsample(benchmark::State& state, UpsampleKernel kernel)
+{
+    std::vector<uint8_t> nearest  = RandomRow(kRowWidth / 2, 4);
+    std::vector<uint8_t> farthest = RandomRow(kRowWidth / 2, 5);
+    std::vector<uint8_t> output(kRowWidth);
+    for (auto _ : state)
+    {
+        kernel(nearest.data(), farthest.data(), output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetRates(state, nearest.size(), output.size());
+}
+
+void BM_ColorConvert(benchmark::State& state, IDCTBackendType type, PixelFormat format)
+{
+    ColorRowKernel       kernel = GetColorRowKernel(type);
+    std::vector<uint8_t> y      = RandomRow(kRowWidth, 6);
+    std::vector<uint8_t> cb     = RandomRow(kRowWidth, 7);
+    std::vector<uint8_t> cr     = RandomRow(kRowWidth, 8);
+    std::vector<uint8_t> output(kRowWidth * BytesPerPixel(format));
+    for (auto _ : state)
+    {
+        YCbCrToPixels(kernel, y.data(), cb.data(), cr.data(), output.data(), kRowWidth, format);
+        benchmark::DoNotOptimize(output.data());
+    }
+    SetRates(state, 3 * kRowWidth, kRowWidth);
+}
+
+//___Whole decodes_____________________________________________________________________________________________________________
+
+void BM_Decode(benchmark::State& state, const std::vector<uint8_t>* data, const OutputInfo& info)
+{
+    for (auto _ : state)
+    {
+        Image image = Decode(*data);
+        benchmark::DoNotOptimize(image.Data());
+    }
+    SetRates(state, data->size(), info.width * info.height);
+}
+
+void BM_DecodeLibjpeg(benchmark::State& state, const std::vector<uint8_t>* data, const OutputInfo& info)
+{
+    std::vector<uint8_t> pixels(info.width * info.height * 3);
+    for (auto _ : state)
+    {
+        struct jpeg_decompress_struct cinfo;
+        struct jpeg_error_mgr         err;
+        cinfo.err = jpeg_std_error(&err);
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, data->data(), data->size());
+        (void)jpeg_read_header(&cinfo, static_cast<boolean>(true));
+        cinfo.out_color_space = JCS_RGB;
+        (void)jpeg_start_decompress(&cinfo);
+        while (cinfo.output_scanline < cinfo.output_height)
+        {
+            JSAMPROW row = pixels.data() + cinfo.output_scanline * info.width * 3;
+            (void)jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        (void)jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        benchmark::DoNotOptimize(pixels.data());
+    }
+    SetRates(state, data->size(), info.width * info.height);
+}
+
+// Every image both decoders read, of Images/ and the synthetic ones.
+void RegisterDecodes()
+{
+    static std::vector<std::unique_ptr<std::vector<uint8_t>>> files;
+    std::vector<std::filesystem::path>                         paths;
+    for (const auto& dir : {kImageDir, kBenchImageDir})
+    {
+        if (!std::filesystem::is_directory(dir))
+        {
+            continue;
+        }
+        for (const auto& entry : std::filesystem::directory_iterator(dir))
+        {
+            if (entry.path().extension() == ".jpg")
+            {
+                paths.push_back(entry.path());
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto& path : paths)
+    {
+        files.push_back(std::make_unique<std::vector<uint8_t>>(ReadFile(path.string())));
+        const std::vector<uint8_t>* data = files.back().get();
+        OutputInfo                  info;
+        try
+        {
+            info = ReadOutputInfo(*data);
+            (void)Decode(*data);
+        } catch (const std::exception&)
+        {
+            continue;
+        }
+        std::string name = "Decode/" + path.stem().string();
+        benchmark::RegisterBenchmark((name + "/jpeg_decoder").c_str(), BM_Decode, data, info)
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark((name + "/libjpeg").c_str(), BM_DecodeLibjpeg, data, info)
+            ->Unit(benchmark::kMillisecond);
+    }
+}
+
+void RegisterKernels()
+{
+    for (auto type : AvailableIDCTBackends())
+    {
+        std::string backend = IDCTBackendTypeToString(type);
+        benchmark::RegisterBenchmark(("BM_IDCT/" + backend).c_str(), BM_IDCT, type, &IDCTBackend::Inverse);
+        benchmark::RegisterBenchmark(("BM_IDCTLow/" + backend).c_str(), BM_IDCT, type, &IDCTBackend::InverseLow);
+        benchmark::RegisterBenchmark(("BM_IDCTDC/" + backend).c_str(), BM_IDCT, type, &IDCTBackend::InverseDC);
+        if (type == IDCTBackendType::FFTW)
+        {
+            continue;
+        }
+        for (auto format : {PixelFormat::RGB8, PixelFormat::RGBA8})
+        {
+            std::string name = "BM_ColorConvert/" + backend + (format == PixelFormat::RGB8 ? "/RGB8" : "/RGBA8");
+            benchmark::RegisterBenchmark(name.c_str(), BM_ColorConvert, type, format);
+        }
+    }
+    size_t half = kRowWidth / 2;
+    benchmark::RegisterBenchmark("BM_Upsample/H2", BM_Upsample,
+                                 [half](const uint8_t* nearest, const uint8_t*, uint8_t* output) {
+                                     UpsampleH2(nearest, output, half);
+                                 });
+    benchmark::RegisterBenchmark("BM_Upsample/H2Fancy", BM_Upsample,
+                                 [half](const uint8_t* nearest, const uint8_t*, uint8_t* output) {
+                                     UpsampleH2Fancy(nearest, output, half);
+                                 });
+    benchmark::RegisterBenchmark("BM_Upsample/H2V2Fancy", BM_Upsample,
+                                 [half](const uint8_t* nearest, const uint8_t* farthest, uint8_t* output) {
+                                     UpsampleH2V2Fancy(nearest, farthest, output, half);
+                                 });
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    RegisterKernels();
+    RegisterDecodes();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
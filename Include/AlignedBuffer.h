@@ -0,0 +1,58 @@
+#pragma once
+
+#include "STDInclude.h"
+#include <new>
+#include <type_traits>
+
+// Uninitialized buffer of trivial values aligned to cache lines. Resizing to a
+// size within the capacity does not reallocate, contents are not preserved.
+template <class T>
+class AlignedBuffer {
+    static_assert(std::is_trivial_v<T>, "AlignedBuffer holds trivial types only.");
+
+public:
+    static constexpr size_t kAlignment = 64;
+
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t size) {
+        Resize(size);
+    }
+
+    // Returns whether the buffer had to be reallocated.
+    bool Resize(size_t size) {
+        size_ = size;
+        if (size <= capacity_) {
+            return false;
+        }
+        data_.reset(static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t(kAlignment))));
+        capacity_ = size;
+        return true;
+    }
+
+    T* Data() {
+        return data_.get();
+    }
+    const T* Data() const {
+        return data_.get();
+    }
+    size_t Size() const {
+        return size_;
+    }
+    T& operator[](size_t id) {
+        return data_.get()[id];
+    }
+    const T& operator[](size_t id) const {
+        return data_.get()[id];
+    }
+
+private:
+    struct Deleter {
+        void operator()(T* data) const {
+            ::operator delete(data, std::align_val_t(kAlignment));
+        }
+    };
+
+    std::unique_ptr<T, Deleter> data_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "STDInclude.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Monotonic allocator for state living as long as a single decode. Memory is
+// handed out of blocks and released all at once by Reset, which keeps a block
+// as large as all of them, so decodes of similar images stop allocating after
+// the first couple.
+class Arena {
+public:
+    static constexpr size_t kMinBlockSize = 4096;
+
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    void* Allocate(size_t size, size_t alignment);
+
+    // Constructs T in the arena, its destructor is run by Reset.
+    template <class T, class... Args>
+    T* Create(Args&&... args) {
+        T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            auto* finalizer = new (Allocate(sizeof(Finalizer), alignof(Finalizer))) Finalizer;
+            finalizer->destroy = [](void* object) { static_cast<T*>(object)->~T(); };
+            finalizer->object = object;
+            finalizer->next = finalizers_;
+            finalizers_ = finalizer;
+        }
+        return object;
+    }
+
+    // Value initialized array of trivial values.
+    template <class T>
+    std::span<T> CreateArray(size_t count) {
+        static_assert(std::is_trivial_v<T>, "Arena arrays hold trivial types only.");
+        T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        std::fill(data, data + count, T{});
+        return {data, count};
+    }
+
+    // Destroys the objects created since the last reset, in reverse order.
+    void Reset();
+
+    // Blocks requested from the heap so far, by this arena and the ones moved into it.
+    size_t HeapAllocations() const {
+        return heap_allocations_;
+    }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    void AddBlock(size_t size);
+    void FreeBlocks();
+
+    // Newest block first, allocations come from the rest of it.
+    Block* blocks_ = nullptr;
+    char* current_ = nullptr;
+    size_t left_ = 0;
+    Finalizer* finalizers_ = nullptr;
+    size_t heap_allocations_ = 0;
+};
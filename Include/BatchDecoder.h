@@ -0,0 +1,46 @@
+#pragma once
+
+#include "STDInclude.h"
+#include "Image.h"
+#include "DecodeOptions.h"
+#include "Decoder.h"
+#include "ThreadPool.h"
+#include <future>
+
+// Decodes many images concurrently, each one on a single thread of the pool
+// with a DecoderContext reused across images. For small images this scales far
+// better than the parallel stages of a single decode, which run inline here.
+class BatchDecoder
+{
+public:
+    // Called on a thread of the pool as soon as image |index| of the batch is
+    // decoded, |error| is set instead of the image if it failed.
+    using Callback = std::function<void(size_t index, Image image, std::exception_ptr error)>;
+
+    explicit BatchDecoder(ThreadPool& pool = ThreadPool::Default());
+    // Waits for the images still being decoded.
+    ~BatchDecoder();
+
+    BatchDecoder(const BatchDecoder&)            = delete;
+    BatchDecoder& operator=(const BatchDecoder&) = delete;
+
+    // Inputs have to outlive their decodes, options.thread_pool is ignored.
+    std::vector<std::future<Image>> Decode(std::span<const std::span<const uint8_t>> inputs,
+                                           const DecodeOptions&                       options = {});
+    void Decode(std::span<const std::span<const uint8_t>> inputs, const DecodeOptions& options, Callback callback);
+
+    // Waits for all images submitted so far, rethrows the first error of the callbacks.
+    void Wait();
+
+private:
+    std::unique_ptr<DecoderContext> AcquireContext();
+    void                            ReleaseContext(std::unique_ptr<DecoderContext> context);
+
+    ThreadPool&                                  pool_;
+    ThreadPool                                   inline_pool_;
+    std::mutex                                   mutex_;
+    // Contexts of finished decodes, there are never more of them than decodes running at once.
+    std::vector<std::unique_ptr<DecoderContext>> idle_contexts_;
+    // Declared last to wait for the decodes before the contexts are freed.
+    TaskGroup                                    tasks_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "IDCT.h"
+#include "Image.h"
+
+// Fixed point BT.601 YCbCr to RGB conversion, same as in libjpeg:
+// r = y + 1.402 * cr, g = y - 0.34414 * cb - 0.71414 * cr, b = y + 1.772 * cb,
+// where chroma is centered around 0 and products are rounded to integers.
+namespace color {
+
+constexpr int kScaleBits = 16;
+constexpr int32_t kHalf = 1 << (kScaleBits - 1);
+constexpr int32_t kCrToR = 91881;
+constexpr int32_t kCbToB = 116130;
+constexpr int32_t kCrToG = -46802;
+constexpr int32_t kCbToG = -22554;
+
+}  // namespace color
+
+// Converts pixels [0, n) of full resolution Y, Cb and Cr rows to |format|, which
+// is not Gray8, and returns n. SIMD kernels may leave a tail of less than a few
+// vectors for the scalar one, the scalar kernel converts all |width| pixels.
+using ColorRowKernel = size_t (*)(const uint8_t* y, const uint8_t* cb, const uint8_t* cr,
+                                  uint8_t* output, size_t width, PixelFormat format);
+
+// Returns kernel for the instruction set of |type|, scalar one if there is no
+// such kernel or the CPU does not support it.
+ColorRowKernel GetColorRowKernel(IDCTBackendType type);
+
+// Converts |width| pixels of a row with |kernel| finishing the tail with the
+// scalar kernel. Gray8 output takes luma only.
+void YCbCrToPixels(ColorRowKernel kernel, const uint8_t* y, const uint8_t* cb, const uint8_t* cr,
+                   uint8_t* output, size_t width, PixelFormat format);
+void GrayToPixels(const uint8_t* y, uint8_t* output, size_t width, PixelFormat format);
+
+// Kernels living in their own translation units, which are compiled with
+// instruction set specific flags. They return nullptr if not built in.
+ColorRowKernel GetSSE41ColorRowKernel();
+ColorRowKernel GetAVX2ColorRowKernel();
+ColorRowKernel GetNEONColorRowKernel();
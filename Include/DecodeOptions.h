@@ -0,0 +1,51 @@
+#pragma once
+
+#include "IDCT.h"
+#include "Image.h"
+#include "Upsample.h"
+
+class ThreadPool;
+struct DecodeStats;
+
+// Output size relative to the image, each side is divided by the value and rounded up.
+enum class DecodeScale
+{
+    Full    = 1,
+    Half    = 2,
+    Quarter = 4,
+    Eighth  = 8
+};
+
+// Rectangle of the output in pixels of the scaled image.
+struct Region
+{
+    size_t x      = 0;
+    size_t y      = 0;
+    size_t width  = 0;
+    size_t height = 0;
+
+    bool Empty() const { return width == 0 || height == 0; }
+};
+
+struct DecodeOptions
+{
+    PixelFormat     pixel_format = PixelFormat::RGB8;
+    UpsamplingMode  upsampling   = UpsamplingMode::Fancy;
+    // Reduced scales use smaller inverse transforms instead of downscaling the output.
+    DecodeScale     scale = DecodeScale::Full;
+    // Only this part of the image is decoded into an output of its size, the
+    // whole image if it is empty.
+    Region          region = {};
+    // Instruction set of IDCT and color conversion kernels.
+    IDCTBackendType idct = IDCTBackendType::Auto;
+
+    // Entropy decode restart intervals concurrently, if the image has them.
+    bool parallel_restart_intervals = false;
+
+    // Pool running parallel stages of the decode, ThreadPool::Default() if not set.
+    ThreadPool* thread_pool = nullptr;
+
+    // Filled in with stage timings and counters of the decode if set. Stats are
+    // written by a single decode at a time, BatchDecoder does not fill them.
+    DecodeStats* stats = nullptr;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "STDInclude.h"
+
+// Stages of a decode timed by DecodeStats.
+enum class DecodeStage
+{
+    MarkerScan = 0,
+    HeaderParse,
+    EntropyDecode,
+    IDCT,
+    // Upsampling of chroma included.
+    ColorConvert,
+    // Allocating the output image. Pixels are converted straight into it, so
+    // they are never copied.
+    OutputCopy
+};
+constexpr size_t kDecodeStageCount = 6;
+std::string      DecodeStageToString(DecodeStage stage);
+
+// Span of a stage on a thread, times are relative to the start of the decode.
+struct TraceEvent
+{
+    DecodeStage stage       = DecodeStage::MarkerScan;
+    // 0 is the thread which started the decode, others are numbered as they join it.
+    size_t      thread      = 0;
+    uint64_t    begin_ns    = 0;
+    uint64_t    duration_ns = 0;
+};
+
+// Where the time of a decode went, filled in if DecodeOptions::stats points to it.
+struct DecodeStats
+{
+    // Nanoseconds of each stage summed over the threads, so stages running in
+    // parallel may add up to more than total_ns.
+    std::array<uint64_t, kDecodeStageCount> stage_ns = {};
+    // Wall time of the whole decode.
+    uint64_t                                total_ns = 0;
+    // Input up to the end of image marker.
+    size_t                                  bytes_consumed = 0;
+    // MCUs and blocks entropy decoded, summed over the scans.
+    size_t                                  mcus       = 0;
+    size_t                                  blocks     = 0;
+    // Blocks whose coefficients ended with an end of block code before the last one.
+    size_t                                  eob_blocks = 0;
+    // Coefficient and sample buffers of the decode, the output image is not included.
+    size_t                                  peak_coefficient_bytes = 0;
+    size_t                                  peak_pixel_bytes       = 0;
+    // A stage is timed per MCU row or per task of the thread pool.
+    std::vector<TraceEvent>                 events;
+
+    uint64_t StageNs(DecodeStage stage) const { return stage_ns[static_cast<size_t>(stage)]; }
+
+    // Writes the events in Chrome trace event format, which chrome://tracing and
+    // Perfetto open, threads are shown as separate tracks.
+    void        WriteChromeTrace(std::ostream& output) const;
+    std::string ChromeTrace() const;
+};
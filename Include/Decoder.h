@@ -2,4 +2,100 @@
 
 #include "STDInclude.h"
 #include "Image.h"
-Image Decode(std::istream& input);
+#include "DecodeOptions.h"
+
+// What the headers say about the output, enough to prepare a buffer for DecodeInto.
+struct OutputInfo
+{
+    size_t      width  = 0;
+    size_t      height = 0;
+    PixelFormat format = PixelFormat::RGB8;
+    std::string comment;
+
+    size_t MinStride() const { return width * BytesPerPixel(format); }
+    size_t RequiredSize(size_t stride) const { return stride * height; }
+};
+
+// Sampling factors of a frame component.
+struct Sampling
+{
+    size_t horizontal = 0;
+    size_t vertical   = 0;
+};
+
+// Frame properties the headers before the first scan tell.
+struct ProbeInfo
+{
+    size_t                  width       = 0;
+    size_t                  height      = 0;
+    size_t                  components  = 0;
+    // Only the first |components| entries are set.
+    std::array<Sampling, 3> sampling;
+    bool                    progressive = false;
+    std::string             comment;
+};
+
+// Decodes jpeg held in memory without copying it.
+Image Decode(std::span<const uint8_t> input, const DecodeOptions& options = {});
+// Reads the rest of the stream into memory first, the stream does not need to be seekable.
+Image Decode(std::istream& input, const DecodeOptions& options = {});
+// Memory maps the file where the platform allows it.
+Image DecodeFile(const std::string& path, const DecodeOptions& options = {});
+
+// Decodes only the |width| x |height| rectangle at (x, y) of the (scaled) image
+// into an image of its size, see DecodeOptions::region.
+Image DecodeRegion(std::span<const uint8_t> input, size_t x, size_t y, size_t width, size_t height,
+                   const DecodeOptions& options = {});
+Image DecodeRegion(std::istream& input, size_t x, size_t y, size_t width, size_t height,
+                   const DecodeOptions& options = {});
+
+// Parses markers up to the first scan header and stops there. Neither the
+// entropy coded data is read nor memory for coefficients and pixels allocated.
+ProbeInfo Probe(std::span<const uint8_t> input);
+// Reads the stream only up to the first scan header, it is not rewound.
+ProbeInfo Probe(std::istream& input);
+ProbeInfo ProbeFile(const std::string& path);
+
+// Parses headers only. The stream is read only up to the first scan and rewound
+// to where it was, so it can be passed to DecodeInto. Streams which can not be
+// rewound, like pipes, are rejected before anything is read from them.
+OutputInfo ReadOutputInfo(std::span<const uint8_t> input, const DecodeOptions& options = {});
+OutputInfo ReadOutputInfo(std::istream& input, const DecodeOptions& options = {});
+
+// Decodes straight into |output|, which must match the image size. The pixel
+// format of |output| takes precedence over options.pixel_format.
+void DecodeInto(std::span<const uint8_t> input, const PixelView& output, const DecodeOptions& options = {});
+void DecodeInto(std::istream& input, const PixelView& output, const DecodeOptions& options = {});
+
+struct DecoderData;
+
+// Decodes images one after another and keeps buffers of the previous one, so
+// a series of similar images allocates little besides their pixels. A context
+// is used by a single thread at a time.
+class DecoderContext
+{
+public:
+    DecoderContext();
+    ~DecoderContext();
+
+    DecoderContext(const DecoderContext&)            = delete;
+    DecoderContext& operator=(const DecoderContext&) = delete;
+
+    Image      Decode(std::span<const uint8_t> input, const DecodeOptions& options = {});
+    OutputInfo ReadOutputInfo(std::span<const uint8_t> input, const DecodeOptions& options = {});
+    void       DecodeInto(std::span<const uint8_t> input, const PixelView& output, const DecodeOptions& options = {});
+
+    // Heap allocations of the decode state kept by the context: blocks of its
+    // arena and coefficient and sample buffers. A decode of an image no larger
+    // than the ones before adds none, nor allocates anything else, whichever
+    // pool it runs on.
+    size_t HeapAllocations() const;
+
+private:
+    // Starts a decode with the buffers of the previous one.
+    DecoderData& Fresh();
+
+    // The current decode and the previous one, whose buffers the next takes.
+    std::unique_ptr<DecoderData> data_;
+    std::unique_ptr<DecoderData> spare_;
+};
@@ -3,6 +3,13 @@
 #include "Section.h"
 #include "Image.h"
 #include "Huffman.h"
+#include "DecodeOptions.h"
+#include "AlignedBuffer.h"
+#include "Arena.h"
+#include "ColorConvert.h"
+#include "Upsample.h"
+#include "ThreadPool.h"
+#include "StatsRecorder.h"
 
 #include <vector>
 #include <memory>
@@ -11,22 +18,122 @@
 
 struct Channel
 {
-    size_t                            dqt_id      = -1;
-    size_t                            dc_id       = -1;
-    size_t                            ac_id       = -1;
-    size_t                            h           = -1;
-    size_t                            w           = -1;
-    bool                              valid       = false;
-    bool                              valid_ac_dc = false;
-    size_t                            du_per_mcu  = -1;
-    std::vector<std::vector<int64_t>> du;
+    size_t                 dqt_id      = -1;
+    size_t                 dc_id       = -1;
+    size_t                 ac_id       = -1;
+    size_t                 h           = -1;
+    size_t                 w           = -1;
+    bool                   valid       = false;
+    bool                   valid_ac_dc = false;
+    size_t                 du_per_mcu  = -1;
+    size_t                 du_w        = 0;
+    size_t                 du_h        = 0;
+    size_t                 blocks_per_line = 0;
+    size_t                 block_lines     = 0;
+    // Block lines kept in coefficients, either a couple of MCU rows or the whole frame.
+    size_t                 coefficient_lines = 0;
+    // 64 coefficients per block, blocks are in raster order.
+    AlignedBuffer<int16_t> coefficients;
+    // Zigzag index of the last nonzero coefficient of each block, 0 if only DC
+    // may be nonzero. Refinements read again after a rollback may overestimate it.
+    AlignedBuffer<uint8_t> last_nonzero;
+    // Samples per side of a transformed block, less than 8 for scaled decoding.
+    size_t                 block_size = 8;
+    // Size of the channel samples without padding to whole blocks.
+    size_t                 sample_width  = 0;
+    size_t                 sample_height = 0;
+    // Samples of a line the region needs, with a margin for upsampling.
+    size_t                 window_begin = 0;
+    size_t                 window_end   = 0;
+    // MCU rows kept in samples, which are used as a ring.
+    size_t                 sample_rows = 0;
+    // Samples planes of sample_rows MCU rows, each one is blocks_per_line by du_h blocks.
+    AlignedBuffer<uint8_t> samples;
+
+    size_t   BlockId(size_t x, size_t y) const { return (y % coefficient_lines) * blocks_per_line + x; }
+    int16_t* Block(size_t x, size_t y) { return coefficients.Data() + BlockId(x, y) * 64; }
+    uint8_t& LastNonzero(size_t x, size_t y) { return last_nonzero[BlockId(x, y)]; }
+    size_t   SamplesStride() const { return blocks_per_line * block_size; }
+    uint8_t* SampleRow(size_t line)
+    {
+        size_t lines = du_h * block_size;
+        return samples.Data() + ((line / lines) % sample_rows * lines + line % lines) * SamplesStride();
+    }
+};
+
+// Channel rows upsampled to the full resolution and sample lines they are made of.
+struct UpsampleBuffer
+{
+    std::array<AlignedBuffer<uint8_t>, 3> rows;
+    std::array<size_t, 3>                 lines;
+
+    // Returns the number of rows which had to be reallocated.
+    size_t Resize(size_t width)
+    {
+        size_t allocations = 0;
+        for (auto& row : rows)
+        {
+            allocations += row.Resize(width);
+        }
+        lines.fill(-1);
+        return allocations;
+    }
 };
 
-struct YCC
+// MCUs [x_begin, x_end) x [y_begin, y_end).
+struct MCURect
 {
-    int64_t y  = 0;
-    int64_t cb = 128;
-    int64_t cr = 128;
+    size_t x_begin = 0;
+    size_t x_end   = 0;
+    size_t y_begin = 0;
+    size_t y_end   = 0;
+};
+
+// Blocks of an MCU, entropy decoding has a loop specialised for each layout.
+enum class MCULayout
+{
+    // One block of a single channel, all scans of grayscale images are such.
+    Single = 0,
+    // Three channels, the first one has 1x1, 2x1, 2x2 or 1x2 blocks and the
+    // others a block each.
+    YCbCr444,
+    YCbCr422,
+    YCbCr420,
+    YCbCr440,
+    // Any other interleaved scan, blocks are counted at run time.
+    Generic
+};
+
+// Scan being decoded, a single channel scan has one block per MCU.
+struct ScanInfo
+{
+    // Ids of the scan channels, allocated in the arena of the decode.
+    std::span<size_t>   channels;
+    MCULayout           layout = MCULayout::Generic;
+    // Spectral selection and successive approximation of progressive scans.
+    size_t              ss = 0;
+    size_t              se = 63;
+    size_t              ah = 0;
+    size_t              al = 0;
+    size_t              mcu_x_cnt = 0;
+    size_t              mcu_cnt   = 0;
+    // MCUs of the scan the decoded region needs.
+    MCURect             needed;
+
+    // Whether MCUs [begin, end) in raster order include a needed one.
+    bool Needs(size_t begin, size_t end) const
+    {
+        for (size_t y = begin / mcu_x_cnt; y * mcu_x_cnt < end && y < needed.y_end; ++y)
+        {
+            size_t x_begin = std::max(begin, y * mcu_x_cnt) - y * mcu_x_cnt;
+            size_t x_end   = std::min(end, (y + 1) * mcu_x_cnt) - y * mcu_x_cnt;
+            if (y >= needed.y_begin && x_begin < needed.x_end && needed.x_begin < x_end)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 struct Tree
@@ -39,8 +146,8 @@ struct Tree
 
 struct DQT
 {
-    bool                 valid = false;
-    std::vector<int64_t> table;
+    bool                    valid = false;
+    std::array<uint16_t, 64> table = {};
 
     void Print() const;
 };
@@ -54,33 +161,105 @@ struct DecoderData
     size_t huffman_cnt;
     size_t image_info_cnt;
     size_t image_data_cnt;
+    size_t restart_interval_cnt;
     size_t unknown_section_cnt;
 
-    std::vector<std::shared_ptr<Section>> sections;
-    Image                                 image;
+    // Transient state of the decode, sections are created in it.
+    Arena                                 arena;
+    std::vector<Section*>                 sections;
+    // Markers of the stream, kept in the arena.
+    MarkerIndex                           markers;
+    std::string                           comment;
+    // Caller's pixels the image is decoded into.
+    PixelView                             output;
     size_t                                width, height;
+    // Size of the output, the region of the frame scaled down by options.scale.
+    size_t                                out_width = 0, out_height = 0;
+    // Offset of the region in the scaled frame.
+    size_t                                crop_x = 0, crop_y = 0;
+    // MCUs the region needs, upsampling margins included.
+    MCURect                               crop_mcus;
+    // Pixels per side of an MCU block in the output.
+    size_t                                out_block = 8;
     size_t                                presicion;
     size_t                                mcu_h     = 0;
     size_t                                mcu_w     = 0;
     size_t                                mcu_x_cnt = 0;
     size_t                                mcu_y_cnt = 0;
     size_t                                mcu_cnt   = 0;
+    size_t                                restart_interval = 0;
+    bool                                  progressive      = false;
+    // Coefficients of the whole frame are kept till all scans are read.
+    bool                                  full_frame       = false;
+    size_t                                scan_cnt         = 0;
+    ScanInfo                              scan;
     std::vector<Channel>                  channels;
 
     std::vector<DQT>  dqts;
     std::vector<Tree> dc, ac;
 
+    DecodeOptions      options;
+    const IDCTBackend* idct         = nullptr;
+    ColorRowKernel     color_kernel = nullptr;
+    // Cr row of images with luma and a single chroma channel.
+    AlignedBuffer<uint8_t> neutral_chroma;
+    // Fills options.stats, if they are asked for.
+    StatsRecorder          stats;
+
     void Info();
 
+    // Takes over buffers of |previous| once it is done with, so decoding a
+    // similar image does not allocate them again.
+    void ReuseBuffers(DecoderData& previous);
+
     void ValidateSectionSet();
     void ValidateImageInfo();
-    void PreValidateImageData();
+    // Validates |scan_info| and prepares buffers for it.
+    void BeginScan(const ScanInfo& scan_info);
+    // Processes rows left after the last scan.
+    void FinishFrame();
 
-    void ProcessInverseDU();
-    void FillImage();
-    void PreProcessDC();
+    // Called once MCU row |row| is entropy decoded. The row is processed on the
+    // thread pool while the next one is decoded.
+    void ScheduleMCURow(size_t row);
+    // Waits for the scheduled rows dropping their errors, a failed decode does
+    // so before its output may be freed.
+    void AbandonRows();
+    // Waits for the scheduled rows and returns how many pixel rows of the output they finished.
+    size_t FinishedRows();
     // void Write();
 
-    YCC GetYCCFromXY(size_t x, size_t y);
-    RGB YCCToRGB(YCC ycc);
+    // Heap allocations of the arena and of the coefficient and sample buffers,
+    // counted over the decodes whose buffers this one took over.
+    size_t HeapAllocations() const { return arena.HeapAllocations() + buffer_allocations_; }
+
+    ThreadPool& Pool() { return options.thread_pool ? *options.thread_pool : ThreadPool::Default(); }
+
+private:
+    // Validates options.region and finds the MCUs and samples it needs.
+    void           SetRegion();
+    // Keeps coefficients and samples of the whole frame if |full_frame|,
+    // otherwise of a few MCU rows, which are processed as soon as they are read.
+    void           AllocateBuffers();
+    // Processes all rows of a full frame in parallel.
+    void           ProcessFrame();
+    // Transforms MCU row |row| and writes finished pixel rows to the output.
+    // Fancy upsampling of the last rows needs the first samples of the next MCU
+    // row, so conversion lags one MCU row behind the transform.
+    void           ProcessMCURow(size_t row);
+    void           TransformMCURow(size_t row);
+    void           ConvertMCURow(size_t row, UpsampleBuffer& buffer);
+    // Reports the coefficient and sample buffers in use to the stats.
+    void           RecordMemory();
+    // Returns pixel row |y| of channel |id| at the full resolution.
+    const uint8_t* UpsampledRow(size_t id, size_t y, UpsampleBuffer& buffer);
+
+    UpsampleBuffer upsample_buffer_;
+    // A buffer per task of ProcessFrame.
+    std::vector<UpsampleBuffer> frame_buffers_;
+    size_t         scheduled_rows_ = 0;
+    // Buffers grow from tasks running in parallel.
+    std::atomic<size_t> buffer_allocations_ = 0;
+    // Declared last to wait for the rows before the buffers they use are freed.
+    std::optional<TaskGroup> row_tasks_;
 };
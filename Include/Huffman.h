@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <span>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -8,6 +10,9 @@
 // HuffmanTree decoder for DHT section.
 class HuffmanTree {
 public:
+    // Amount of leading bits resolved by a single lookup table access.
+    static constexpr size_t kLookupBits = 9;
+
     HuffmanTree();
 
     HuffmanTree(const HuffmanTree&) = delete;
@@ -20,18 +25,56 @@ public:
     // terminated nodes in the Huffman tree.
     // values are the values of the terminated nodes in the consecutive
     // level order.
-    void Build(const std::vector<uint8_t>& code_lengths, const std::vector<uint8_t>& values);
+    void Build(std::span<const uint8_t> code_lengths, std::span<const uint8_t> values);
+
+    // Decodes one code from |bits|, which holds the next 16 bits of the stream
+    // (first bit is the most significant one). Returns the length of the code
+    // and overwrites |value|.
+    size_t Decode(uint32_t bits, int& value) const {
+        uint16_t entry = lookup_[bits >> (16 - kLookupBits)];
+        if (entry != 0) {
+            value = entry & 0xff;
+            return entry >> 8;
+        }
+        return DecodeLong(bits, value);
+    }
+
+    // Decodes the code together with the magnitude bits that follow it, if both
+    // fit into kLookupBits. Returns the total length, or 0 if slow path is needed.
+    // |run| is the high nibble of the symbol, |coefficient| is the sign extended
+    // magnitude (0 for symbols without magnitude bits).
+    size_t DecodeFast(uint32_t bits, int& run, int& coefficient) const {
+        int16_t entry = fast_[bits >> (16 - kLookupBits)];
+        if (entry == 0) {
+            return 0;
+        }
+        run = (entry >> 4) & 0xf;
+        coefficient = entry >> 8;
+        return entry & 0xf;
+    }
 
     // Moves the state of the huffman tree by |bit|. If the node is terminated,
     // returns true and overwrites |value|. If it is intermediate, returns false
     // and value is unmodified.
     bool Move(bool bit, int& value);
-    // size_t Size() const;
-    // void PrintCodes() const;
 
     ~HuffmanTree();
 
 private:
-    class Impl;
-    std::unique_ptr<Impl> impl_;
+    size_t DecodeLong(uint32_t bits, int& value) const;
+
+    // (length << 8) | value for codes not longer than kLookupBits, 0 otherwise.
+    std::array<uint16_t, 1 << kLookupBits> lookup_ = {};
+    // (coefficient << 8) | (run << 4) | total_length, 0 if code and magnitude
+    // do not fit into kLookupBits.
+    std::array<int16_t, 1 << kLookupBits> fast_ = {};
+    // Largest code of each length, -1 if there are no codes of that length.
+    std::array<int32_t, 17> max_code_;
+    // Index of the value of code |c| with length |l| is c + value_offset_[l].
+    std::array<int32_t, 17> value_offset_ = {};
+    std::array<uint8_t, 256> values_ = {};
+    bool built_ = false;
+
+    int32_t move_code_ = 0;
+    size_t move_length_ = 0;
 };
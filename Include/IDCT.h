@@ -0,0 +1,65 @@
+#pragma once
+
+#include "STDInclude.h"
+
+enum class IDCTBackendType {
+    Auto = 0,
+    Scalar,
+    SSE41,
+    AVX2,
+    NEON,
+    FFTW
+};
+std::string IDCTBackendTypeToString(IDCTBackendType type);
+// Whether the CPU runs instructions of the set |type| is named after.
+bool CpuSupports(IDCTBackendType type);
+// Whether decodes with backend |type| are bit-exact with libjpeg's islow IDCT,
+// upsampling and color conversion, which makes their output the same on every
+// machine. All but the floating point FFTW reference are.
+bool IsBitExact(IDCTBackendType type);
+
+class IDCTBackend {
+public:
+    virtual ~IDCTBackend() = default;
+    virtual IDCTBackendType Type() const = 0;
+
+    // Dequantizes |coefficients| by |quant| (both 8x8 in natural order) and
+    // writes level shifted and clamped samples to |output|, which rows are
+    // |stride| bytes apart.
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const = 0;
+    // Same as Inverse for a block whose nonzero coefficients are in its top left
+    // 4x4 corner, which lets fixed point backends skip the zero half of each pass.
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const;
+    // Same as Inverse for a block with no nonzero AC coefficient, which is filled
+    // with a single sample.
+    virtual void InverseDC(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                           size_t stride) const;
+};
+
+// Blocks whose last nonzero coefficient in zigzag order comes before this one
+// have all of them in the top left 4x4 corner.
+constexpr uint8_t kLowFrequencyEnd = 10;
+
+// Reduced transforms of libjpeg's scaled decoding, which write |size| x |size|
+// (4, 2 or 1) samples of the block to |output|. Inputs are the same as of
+// IDCTBackend::Inverse, the 1x1 transform reads the DC coefficient only.
+void InverseReduced(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                    size_t stride, size_t size);
+
+// InverseReduced of a block with no nonzero AC coefficient, the DC is the
+// sample of all |size| x |size| of them.
+void InverseReducedDC(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                      size_t stride, size_t size);
+
+// Returns backend of |type| or nullptr if it is not built in or not supported
+// by the CPU. Auto picks the fastest available one.
+const IDCTBackend* GetIDCTBackend(IDCTBackendType type);
+std::vector<IDCTBackendType> AvailableIDCTBackends();
+
+// Backends living in their own translation units, which are compiled with
+// instruction set specific flags. They return nullptr if not built in.
+const IDCTBackend* GetSSE41IDCTBackend();
+const IDCTBackend* GetAVX2IDCTBackend();
+const IDCTBackend* GetNEONIDCTBackend();
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+
+// Fixed point Loeffler-Ligtenberg-Moschytz inverse DCT with the constants and
+// rounding of libjpeg's islow method. The 1D transform is written once for any
+// V, which is either int64_t or a SIMD vector of int32_t lanes supporting +, -,
+// multiplication by int32_t, shifts by int and construction from int32_t. Sums
+// of corrupt inputs only fit the former, as they do libjpeg's JLONG, the lanes
+// wrap around.
+namespace idct {
+
+constexpr int kConstBits = 13;
+constexpr int kPass1Bits = 2;
+// Shifts which descale the results of the first (columns) and the second (rows)
+// passes.
+constexpr int kPass1Shift = kConstBits - kPass1Bits;
+constexpr int kPass2Shift = kConstBits + kPass1Bits + 3;
+
+constexpr int32_t kFix_0_298631336 = 2446;
+constexpr int32_t kFix_0_390180644 = 3196;
+constexpr int32_t kFix_0_541196100 = 4433;
+constexpr int32_t kFix_0_765366865 = 6270;
+constexpr int32_t kFix_0_899976223 = 7373;
+constexpr int32_t kFix_1_175875602 = 9633;
+constexpr int32_t kFix_1_501321110 = 12299;
+constexpr int32_t kFix_1_847759065 = 15137;
+constexpr int32_t kFix_1_961570560 = 16069;
+constexpr int32_t kFix_2_053119869 = 16819;
+constexpr int32_t kFix_2_562915447 = 20995;
+constexpr int32_t kFix_3_072711026 = 25172;
+
+template <int Shift, class V>
+inline V Descale(V x) {
+    return (x + V(1 << (Shift - 1))) >> Shift;
+}
+
+template <int Shift, class V>
+inline void Inverse1D(const V* in, V* out) {
+    // Even part.
+    V z2 = in[2];
+    V z3 = in[6];
+    V z1 = (z2 + z3) * kFix_0_541196100;
+    V tmp2 = z1 + z3 * (-kFix_1_847759065);
+    V tmp3 = z1 + z2 * kFix_0_765366865;
+    V tmp0 = (in[0] + in[4]) << kConstBits;
+    V tmp1 = (in[0] - in[4]) << kConstBits;
+
+    V tmp10 = tmp0 + tmp3;
+    V tmp13 = tmp0 - tmp3;
+    V tmp11 = tmp1 + tmp2;
+    V tmp12 = tmp1 - tmp2;
+
+    // Odd part.
+    tmp0 = in[7];
+    tmp1 = in[5];
+    tmp2 = in[3];
+    tmp3 = in[1];
+
+    z1 = tmp0 + tmp3;
+    z2 = tmp1 + tmp2;
+    z3 = tmp0 + tmp2;
+    V z4 = tmp1 + tmp3;
+    V z5 = (z3 + z4) * kFix_1_175875602;
+
+    tmp0 = tmp0 * kFix_0_298631336;
+    tmp1 = tmp1 * kFix_2_053119869;
+    tmp2 = tmp2 * kFix_3_072711026;
+    tmp3 = tmp3 * kFix_1_501321110;
+    z1 = z1 * (-kFix_0_899976223);
+    z2 = z2 * (-kFix_2_562915447);
+    z3 = z3 * (-kFix_1_961570560) + z5;
+    z4 = z4 * (-kFix_0_390180644) + z5;
+
+    tmp0 = tmp0 + z1 + z3;
+    tmp1 = tmp1 + z2 + z4;
+    tmp2 = tmp2 + z2 + z3;
+    tmp3 = tmp3 + z1 + z4;
+
+    out[0] = Descale<Shift>(tmp10 + tmp3);
+    out[7] = Descale<Shift>(tmp10 - tmp3);
+    out[1] = Descale<Shift>(tmp11 + tmp2);
+    out[6] = Descale<Shift>(tmp11 - tmp2);
+    out[2] = Descale<Shift>(tmp12 + tmp1);
+    out[5] = Descale<Shift>(tmp12 - tmp1);
+    out[3] = Descale<Shift>(tmp13 + tmp0);
+    out[4] = Descale<Shift>(tmp13 - tmp0);
+}
+
+// Inverse1D of inputs 4-7 being zero, which are not read. The results are
+// those of Inverse1D, only the terms known to be zero are left out.
+template <int Shift, class V>
+inline void Inverse1DLow(const V* in, V* out) {
+    // Even part.
+    V z1 = in[2] * kFix_0_541196100;
+    V tmp2 = z1;
+    V tmp3 = z1 + in[2] * kFix_0_765366865;
+    V tmp0 = in[0] << kConstBits;
+
+    V tmp10 = tmp0 + tmp3;
+    V tmp13 = tmp0 - tmp3;
+    V tmp11 = tmp0 + tmp2;
+    V tmp12 = tmp0 - tmp2;
+
+    // Odd part, of inputs 1 and 3.
+    V z5 = (in[3] + in[1]) * kFix_1_175875602;
+    z1 = in[1] * (-kFix_0_899976223);
+    V z2 = in[3] * (-kFix_2_562915447);
+    V z3 = in[3] * (-kFix_1_961570560) + z5;
+    V z4 = in[1] * (-kFix_0_390180644) + z5;
+
+    tmp0 = z1 + z3;
+    V tmp1 = z2 + z4;
+    tmp2 = in[3] * kFix_3_072711026 + z2 + z3;
+    tmp3 = in[1] * kFix_1_501321110 + z1 + z4;
+
+    out[0] = Descale<Shift>(tmp10 + tmp3);
+    out[7] = Descale<Shift>(tmp10 - tmp3);
+    out[1] = Descale<Shift>(tmp11 + tmp2);
+    out[6] = Descale<Shift>(tmp11 - tmp2);
+    out[2] = Descale<Shift>(tmp12 + tmp1);
+    out[5] = Descale<Shift>(tmp12 - tmp1);
+    out[3] = Descale<Shift>(tmp13 + tmp0);
+    out[4] = Descale<Shift>(tmp13 - tmp0);
+}
+
+// Sample of a block whose only nonzero coefficient is the dequantized |dc|,
+// descaled the way libjpeg's shortcut for such columns and rows does it.
+inline int32_t InverseDC(int32_t dc) {
+    return Descale<kPass1Bits + 3>(dc << kPass1Bits);
+}
+
+// Level shift and range limit of the second pass output. Values are wrapped
+// the same way libjpeg's range limit table does it.
+inline uint8_t RangeLimit(int64_t x) {
+    int64_t value = ((x + 512) & 1023) - 384;
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+}  // namespace idct
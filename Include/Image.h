@@ -1,44 +1,195 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <utility>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <memory>
+#include <functional>
+#include <new>
 
 struct RGB
 {
     int r, g, b;
 };
 
+enum class PixelFormat
+{
+    RGB8 = 0,
+    RGBA8,
+    BGR8,
+    Gray8
+};
+
+inline size_t BytesPerPixel(PixelFormat format)
+{
+    switch (format)
+    {
+        case PixelFormat::RGB8:
+        case PixelFormat::BGR8: return 3;
+        case PixelFormat::RGBA8: return 4;
+        case PixelFormat::Gray8: return 1;
+    }
+    return 0;
+}
+
+// Non owning view of caller's pixels, rows are |stride| bytes apart.
+struct PixelView
+{
+    uint8_t*    data   = nullptr;
+    size_t      width  = 0;
+    size_t      height = 0;
+    size_t      stride = 0;
+    PixelFormat format = PixelFormat::RGB8;
+
+    uint8_t* Row(size_t y) const { return data + y * stride; }
+};
+
+// Pixels are stored in a single buffer, rows are Stride() bytes apart and
+// every row starts at kAlignment boundary if the buffer was allocated by Image.
 class Image
 {
 public:
-    Image() = default;
-    Image(size_t width, size_t height) { SetSize(width, height); }
+    using Deleter = std::function<void(uint8_t*)>;
+    using Buffer  = std::unique_ptr<uint8_t[], Deleter>;
 
-    void SetSize(size_t width, size_t height) { data_.assign(height, std::vector<RGB>(width)); }
+    static constexpr size_t kAlignment = 64;
 
-    size_t Width() const
+    static size_t AlignedStride(size_t width, PixelFormat format)
     {
-        if (data_.empty())
+        size_t row = width * BytesPerPixel(format);
+        return (row + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // Allocates buffer, which can be freed with a deleter from the result.
+    static Buffer Allocate(size_t size)
+    {
+        auto* data = static_cast<uint8_t*>(::operator new(size, std::align_val_t(kAlignment)));
+        return Buffer(data, [](uint8_t* data) { ::operator delete(data, std::align_val_t(kAlignment)); });
+    }
+
+    Image() = default;
+    Image(size_t width, size_t height, PixelFormat format = PixelFormat::RGB8) { SetSize(width, height, format); }
+
+    Image(const Image& other) { *this = other; }
+    Image& operator=(const Image& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        SetSize(other.width_, other.height_, other.format_);
+        for (size_t y = 0; y < height_; ++y)
         {
-            return 0;
+            std::memcpy(Row(y), other.Row(y), width_ * BytesPerPixel(format_));
         }
-        return data_[0].size();
+        comment_ = other.comment_;
+        return *this;
+    }
+    Image(Image&& other) noexcept { *this = std::move(other); }
+    Image& operator=(Image&& other) noexcept
+    {
+        data_    = std::move(other.data_);
+        width_   = std::exchange(other.width_, 0);
+        height_  = std::exchange(other.height_, 0);
+        stride_  = std::exchange(other.stride_, 0);
+        format_  = other.format_;
+        comment_ = std::move(other.comment_);
+        return *this;
     }
 
-    size_t Height() const { return data_.size(); }
+    // Contents of the pixels are unspecified after resize.
+    void SetSize(size_t width, size_t height, PixelFormat format = PixelFormat::RGB8)
+    {
+        stride_ = AlignedStride(width, format);
+        data_   = Allocate(std::max<size_t>(stride_ * height, 1));
+        width_  = width;
+        height_ = height;
+        format_ = format;
+    }
+
+    size_t Width() const { return width_; }
+
+    size_t Height() const { return height_; }
+
+    size_t Stride() const { return stride_; }
+
+    PixelFormat Format() const { return format_; }
+
+    uint8_t* Data() { return data_.get(); }
+
+    const uint8_t* Data() const { return data_.get(); }
+
+    uint8_t* Row(size_t y) { return data_.get() + y * stride_; }
+
+    const uint8_t* Row(size_t y) const { return data_.get() + y * stride_; }
+
+    PixelView View() { return {data_.get(), width_, height_, stride_, format_}; }
+
+    void SetPixel(int y, int x, const RGB& pixel)
+    {
+        uint8_t* p = Row(y) + x * BytesPerPixel(format_);
+        switch (format_)
+        {
+            case PixelFormat::RGBA8: p[3] = 255; [[fallthrough]];
+            case PixelFormat::RGB8:
+                p[0] = pixel.r;
+                p[1] = pixel.g;
+                p[2] = pixel.b;
+                break;
+            case PixelFormat::BGR8:
+                p[0] = pixel.b;
+                p[1] = pixel.g;
+                p[2] = pixel.r;
+                break;
+            case PixelFormat::Gray8: p[0] = (pixel.r * 19595 + pixel.g * 38470 + pixel.b * 7471 + 32768) >> 16; break;
+        }
+    }
 
-    void SetPixel(int y, int x, const RGB& pixel) { data_[y][x] = pixel; }
+    RGB GetPixel(int y, int x) const
+    {
+        const uint8_t* p = Row(y) + x * BytesPerPixel(format_);
+        switch (format_)
+        {
+            case PixelFormat::RGB8:
+            case PixelFormat::RGBA8: return {p[0], p[1], p[2]};
+            case PixelFormat::BGR8: return {p[2], p[1], p[0]};
+            case PixelFormat::Gray8: return {p[0], p[0], p[0]};
+        }
+        return {};
+    }
 
-    RGB GetPixel(int y, int x) const { return data_[y][x]; }
+    // Hands the pixel buffer over to the caller, the image becomes empty.
+    Buffer Release()
+    {
+        width_  = 0;
+        height_ = 0;
+        stride_ = 0;
+        return std::move(data_);
+    }
 
-    RGB& GetPixel(int y, int x) { return data_[y][x]; }
+    // Takes ownership of |data| holding |height| rows |stride| bytes apart.
+    void Adopt(Buffer data, size_t width, size_t height, size_t stride, PixelFormat format)
+    {
+        data_   = std::move(data);
+        width_  = width;
+        height_ = height;
+        stride_ = stride;
+        format_ = format;
+    }
 
     void SetComment(const std::string& comment) { comment_ = comment; }
 
     const std::string& GetComment() const { return comment_; }
 
 private:
-    std::vector<std::vector<RGB>> data_;
-    std::string                   comment_;
+    Buffer      data_;
+    size_t      width_  = 0;
+    size_t      height_ = 0;
+    size_t      stride_ = 0;
+    PixelFormat format_ = PixelFormat::RGB8;
+    std::string comment_;
 };
@@ -3,70 +3,180 @@
 #include "StreamNavigator.h"
 #include "DecoderData.h"
 
-const std::vector<size_t> kTransformX = {
-    0,                       //
-    1, 0,                    //
-    0, 1, 2,                 //
-    3, 2, 1, 0,              //
-    0, 1, 2, 3, 4,           //
-    5, 4, 3, 2, 1, 0,        //
-    0, 1, 2, 3, 4, 5, 6,     //
-    7, 6, 5, 4, 3, 2, 1, 0,  //
-    1, 2, 3, 4, 5, 6, 7,     //
-    7, 6, 5, 4, 3, 2,        //
-    3, 4, 5, 6, 7,           //
-    7, 6, 5, 4,              //
-    5, 6, 7,                 //
-    7, 6,                    //
-    7                        //
-};
-const std::vector<size_t> kTransformY = {
-    0,                       //
-    0, 1,                    //
-    2, 1, 0,                 //
-    0, 1, 2, 3,              //
-    4, 3, 2, 1, 0,           //
-    0, 1, 2, 3, 4, 5,        //
-    6, 5, 4, 3, 2, 1, 0,     //
-    0, 1, 2, 3, 4, 5, 6, 7,  //
-    7, 6, 5, 4, 3, 2, 1,     //
-    2, 3, 4, 5, 6, 7,        //
-    7, 6, 5, 4, 3,           //
-    4, 5, 6, 7,              //
-    7, 6, 5,                 //
-    6, 7,                    //
-    7,                       //
+// Natural order index of the coefficient at each zigzag position.
+constexpr std::array<uint8_t, 64> kZigZag = {
+    0,  1,  8,  16, 9,  2,  3,  10,  //
+    17, 24, 32, 25, 18, 11, 4,  5,   //
+    12, 19, 26, 33, 40, 48, 41, 34,  //
+    27, 20, 13, 6,  7,  14, 21, 28,  //
+    35, 42, 49, 56, 57, 50, 43, 36,  //
+    29, 22, 15, 23, 30, 37, 44, 51,  //
+    58, 59, 52, 45, 38, 31, 39, 46,  //
+    53, 60, 61, 54, 47, 55, 62, 63,  //
 };
 
-size_t Last(size_t n) {
+inline size_t Last(size_t n) {
     return (n & 0xf0) >> 4;
 }
-size_t First(size_t n) {
+inline size_t First(size_t n) {
     return (n & 0x0f);
 }
 
+inline uint64_t LoadBigEndian64(const uint8_t* data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+#if defined(__GNUC__) || defined(__clang__)
+    if constexpr (std::endian::native == std::endian::little) {
+        word = __builtin_bswap64(word);
+    }
+#else
+    if constexpr (std::endian::native == std::endian::little) {
+        uint64_t swapped = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            swapped = (swapped << 8) | data[i];
+        }
+        word = swapped;
+    }
+#endif
+    return word;
+}
+
+// Reads entropy coded data through a 64-bit buffer, removing stuffed zero
+// bytes while refilling. Bits past the end of the data are zeros, consuming
+// them is an error.
 class BitReader {
 private:
-    StreamNavigator stream_;
+    const uint8_t* data_;
+    size_t size_;
     size_t pos_ = 0;
+    uint64_t buffer_ = 0;
+    size_t bits_ = 0;
+    size_t padding_ = 0;
+    bool marker_ = false;
+
+    static bool HasFF(uint64_t word) {
+        uint64_t inverted = ~word;
+        return ((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) != 0;
+    }
+
+    void RefillFast() {
+        uint64_t word = LoadBigEndian64(data_ + pos_);
+        if (!HasFF(word)) {
+            size_t bytes = (64 - bits_) / 8;
+            buffer_ |= (word >> (64 - 8 * bytes)) << (64 - bits_ - 8 * bytes);
+            bits_ += 8 * bytes;
+            pos_ += bytes;
+            return;
+        }
+        RefillChecked();
+    }
+
+    void RefillChecked() {
+        while (bits_ <= 56) {
+            if (marker_ || pos_ >= size_) {
+                padding_ += 8;
+                bits_ += 8;
+                continue;
+            }
+            uint64_t byte = data_[pos_];
+            if (byte == 0xff) {
+                if (pos_ + 1 >= size_ || data_[pos_ + 1] != 0) {
+                    marker_ = true;
+                    continue;
+                }
+                ++pos_;
+            }
+            ++pos_;
+            buffer_ |= byte << (56 - bits_);
+            bits_ += 8;
+        }
+    }
+
+    void Refill() {
+        if (!marker_ && pos_ + 8 <= size_) {
+            RefillFast();
+        } else {
+            RefillChecked();
+        }
+    }
 
 public:
-    BitReader(StreamNavigator stream) : stream_(stream) {
+    BitReader(StreamNavigator stream) : data_(stream.Data()), size_(stream.Size()) {
+    }
+
+    // Returns next |count| (from 1 to 32) bits without consuming them.
+    uint32_t Peek(size_t count) {
+        if (bits_ < count) {
+            Refill();
+        }
+        return buffer_ >> (64 - count);
+    }
+
+    void Consume(size_t count) {
+        DATA_ERROR_IF(count > bits_ - padding_, "Unexpected end of data.");
+        buffer_ <<= count;
+        bits_ -= count;
+    }
+
+    uint32_t ReadBits(size_t count) {
+        uint32_t value = Peek(count);
+        Consume(count);
+        return value;
+    }
+
+    // Continues with |stream|, which starts where the data consumed so far ends
+    // and holds more of it. Zero bits appended past the old end are dropped.
+    void Resume(StreamNavigator stream) {
+        data_ = stream.Data();
+        size_ = stream.Size();
+        pos_ = 0;
+        bits_ -= padding_;
+        padding_ = 0;
+        marker_ = false;
     }
-    size_t Pos() const {
+
+    // Bytes consumed from the current data.
+    size_t Position() const {
         return pos_;
     }
 
-    int Read() {
-        if (pos_ % 8 == 0 && pos_ != 0) {
-            size_t i = pos_ / 8;
-            if (stream_[i - 1] == 0xff) {
-                DATA_ERROR_IF(stream_[i] != 0, "FF without 00.");
-                pos_ += 8;
+    // True if the reader got to the end of the data, so the failed read may
+    // succeed with more of it.
+    bool Starved() const {
+        return pos_ + 1 >= size_;
+    }
+
+    // Moves to the marker ending the current restart interval without decoding
+    // the rest of it, or to the end of the data if the marker is not there yet.
+    void SkipInterval() {
+        buffer_ = 0;
+        bits_ = 0;
+        padding_ = 0;
+        marker_ = false;
+        while (pos_ < size_) {
+            const void* found = std::memchr(data_ + pos_, 0xff, size_ - pos_);
+            if (!found) {
+                pos_ = size_;
+                return;
             }
+            pos_ = static_cast<const uint8_t*>(found) - data_;
+            if (pos_ + 1 >= size_ || data_[pos_ + 1] != 0) {
+                return;
+            }
+            pos_ += 2;
         }
-        // std::cout << stream_.bit(pos_) << std::flush;
-        return stream_.Bit(pos_++);
+    }
+
+    // Drops fill bits of the current restart interval and skips the RSTn
+    // marker with number |marker|.
+    void Restart(size_t marker) {
+        DATA_ERROR_IF(pos_ + 1 >= size_ || data_[pos_] != 0xff || data_[pos_ + 1] != 0xd0 + marker,
+                      "Wrong restart marker.");
+        pos_ += 2;
+        buffer_ = 0;
+        bits_ = 0;
+        padding_ = 0;
+        marker_ = false;
     }
 };
 
@@ -74,14 +184,29 @@ class MCUReader {
 private:
     BitReader reader_;
     DecoderData& data_;
+    // DC predictions of the channels.
+    std::array<int64_t, 3> predictions_ = {};
+    size_t next_restart_ = 0;
+    // Blocks left in the current band only run of progressive AC scans.
+    size_t eobrun_ = 0;
+    // MCUs before it belong to a restart interval the region does not need.
+    size_t skip_end_ = 0;
+    DecodeCounters counters_;
     int64_t HuffmanValue(HuffmanTree& tree) {
         int value;
-        while (!tree.Move(reader_.Read(), value)) {
-        }
+        reader_.Consume(tree.Decode(reader_.Peek(16), value));
         return value;
     }
     std::pair<int64_t, int64_t> ReadPair(HuffmanTree& tree, bool dc = false) {
         std::pair<int64_t, int64_t> ans = {0, 0};
+        int run, coefficient;
+        if (size_t length = tree.DecodeFast(reader_.Peek(16), run, coefficient)) {
+            DATA_ERROR_IF(dc && run != 0, "Oops, now you have to fix it.");
+            reader_.Consume(length);
+            ans.first = run;
+            ans.second = coefficient;
+            return ans;
+        }
         int value = HuffmanValue(tree);
         int len = 0;
         if (dc) {
@@ -95,92 +220,342 @@ private:
         if (!len) {
             return ans;
         }
-        int cnt = len;
-
-        ans.second = reader_.Read();
-        int mult = ans.second;
-        --cnt;
-        while (cnt) {
-            --cnt;
-            ans.second <<= 1;
-            ans.second += reader_.Read();
-        }
-        if (!mult) {
+        ans.second = reader_.ReadBits(len);
+        if (ans.second < (1 << (len - 1))) {
             ans.second = ans.second - (1 << len) + 1;
         }
         return ans;
     }
-    std::vector<std::pair<int64_t, int64_t>> ReadPairs(HuffmanTree& dc, HuffmanTree& ac) {
-        std::vector<std::pair<int64_t, int64_t>> ans;
-        ans.reserve(64);
-        ans.push_back(ReadPair(dc, true));
-        size_t cnt_elems = 1;
-        while (cnt_elems < 64) {
-            auto pair = ReadPair(ac);
-            ans.push_back(pair);
-            cnt_elems += 1 + pair.first;
-            if (ans.back().first == 0 && ans.back().second == 0) {
-                cnt_elems = 64;
+    // Reads a baseline block straight into natural order. The block is zeroed in
+    // bulk, so only nonzero coefficients are written.
+    void ReadDU(HuffmanTree& dc, HuffmanTree& ac, int64_t& prediction, int16_t* block, uint8_t& last) {
+        std::memset(block, 0, 64 * sizeof(int16_t));
+        block[0] = ReadPair(dc, true).second + prediction;
+        prediction = block[0];
+        last = 0;
+        for (size_t k = 1; k < 64; ++k) {
+            auto [run, value] = ReadPair(ac);
+            if (run == 0 && value == 0) {
+                ++counters_.eob_blocks;
+                return;
+            }
+            k += run;
+            DATA_ERROR_IF(k >= 64, "To many pairs for DU.");
+            // Runs of 16 zeros have no value.
+            if (value != 0) {
+                block[kZigZag[k]] = value;
+                last = k;
+            }
+        }
+    }
+
+    // Extends |bits| long magnitude to a signed value.
+    int32_t ReceiveExtend(size_t bits) {
+        if (!bits) {
+            return 0;
+        }
+        int32_t value = reader_.ReadBits(bits);
+        if (value < (1 << (bits - 1))) {
+            value -= (1 << bits) - 1;
+        }
+        return value;
+    }
+
+    void ReadDCFirst(HuffmanTree& dc, int64_t& prediction, int16_t* block) {
+        int64_t bits = HuffmanValue(dc);
+        DATA_ERROR_IF(bits >= 16, "Oops, now you have to fix it.");
+        prediction += ReceiveExtend(bits);
+        block[0] = prediction * (1 << data_.scan.al);
+    }
+    void ReadDCRefine(int16_t* block) {
+        if (reader_.ReadBits(1)) {
+            block[0] |= 1 << data_.scan.al;
+        }
+    }
+    void ReadACFirst(HuffmanTree& ac, int16_t* block, uint8_t& last) {
+        if (eobrun_ > 0) {
+            --eobrun_;
+            ++counters_.eob_blocks;
+            return;
+        }
+        const ScanInfo& scan = data_.scan;
+        for (size_t k = scan.ss; k <= scan.se; ++k) {
+            int value = HuffmanValue(ac);
+            size_t run = Last(value);
+            size_t bits = First(value);
+            if (bits) {
+                k += run;
+                DATA_ERROR_IF(k > scan.se, "To many pairs for DU.");
+                block[kZigZag[k]] = ReceiveExtend(bits) * (1 << scan.al);
+                last = std::max<uint8_t>(last, k);
+            } else if (run == 15) {
+                k += 15;
+            } else {
+                eobrun_ = (1 << run) - 1;
+                if (run) {
+                    eobrun_ += reader_.ReadBits(run);
+                }
+                ++counters_.eob_blocks;
                 break;
             }
         }
-        DATA_ERROR_IF(cnt_elems != 64, "Wrong elemnts amount for du.");
-        // std::cout << "\nDU readed" << std::endl;
-        return ans;
     }
-    std::vector<int64_t> ReadDU(HuffmanTree& dc, HuffmanTree& ac) {
-        auto pairs = ReadPairs(dc, ac);
-        // std::cout << "|" << std::flush;
-        // std::cout << std::endl;
-        // for (auto [zero, value] : pairs) {
-        //     std::cout << zero << " " << value << std::endl;
-        // }
-        std::vector<int64_t> res(64);
-        size_t current = 0;
-        for (auto [zeros, value] : pairs) {
-            while (zeros) {
-                --zeros;
-                DATA_ERROR_IF(current >= 64, "To many pairs for DU.");
-                res[kTransformX[current] + 8 * kTransformY[current]] = 0;
-                ++current;
-            }
-            DATA_ERROR_IF(current >= 64, "To many pairs for DU.");
-            res[kTransformX[current] + 8 * kTransformY[current]] = value;
-            ++current;
-        }
-        for (; current < 64; ++current) {
-            res[kTransformX[current] + 8 * kTransformY[current]] = 0;
-        }
-        // std::cout << std::endl;
-        // for (size_t y = 0; y < 8; ++y) {
-        //     for (size_t x = 0; x < 8; ++x) {
-        //         std::cout << res[x + y * 8] << " ";
-        //     }
-        //     std::cout << std::endl;
-        // }
-        return res;
-    }
-
-    void ReadMCU() {
-        for (size_t i = 0; i < data_.channels.size(); ++i) {
-            auto& dc = data_.dc[data_.channels[i].dc_id].tree;
-            auto& ac = data_.ac[data_.channels[i].ac_id].tree;
-            for (size_t k = 0; k < data_.channels[i].du_per_mcu; ++k) {
-                // std::cout << "Reading block with: " << data_.channels[i].dc_id << " "
-                //           << data_.channels[i].ac_id << std::endl;
-                data_.channels[i].du.push_back(ReadDU(dc, ac));
+    // Corrects already nonzero coefficient by a bit of the current approximation.
+    void Refine(int16_t& coefficient) {
+        int16_t bit = 1 << data_.scan.al;
+        if (reader_.ReadBits(1) && (coefficient & bit) == 0) {
+            coefficient += coefficient >= 0 ? bit : -bit;
+        }
+    }
+    void ReadACRefine(HuffmanTree& ac, int16_t* block, uint8_t& last) {
+        const ScanInfo& scan = data_.scan;
+        int16_t bit = 1 << scan.al;
+        size_t k = scan.ss;
+        auto coefficient = [&](size_t id) -> int16_t& {
+            return block[kZigZag[id]];
+        };
+        if (eobrun_ == 0) {
+            for (; k <= scan.se; ++k) {
+                int value = HuffmanValue(ac);
+                int run = Last(value);
+                size_t bits = First(value);
+                int16_t new_value = 0;
+                if (bits) {
+                    DATA_ERROR_IF(bits != 1, "Wrong refinement magnitude.");
+                    new_value = reader_.ReadBits(1) ? bit : -bit;
+                } else if (run != 15) {
+                    eobrun_ = 1 << run;
+                    if (run) {
+                        eobrun_ += reader_.ReadBits(run);
+                    }
+                    break;
+                }
+                // Skips |run| zero coefficients refining nonzero ones on the way.
+                for (; k <= scan.se; ++k) {
+                    if (coefficient(k) != 0) {
+                        Refine(coefficient(k));
+                    } else if (--run < 0) {
+                        break;
+                    }
+                }
+                if (new_value) {
+                    DATA_ERROR_IF(k > scan.se, "To many pairs for DU.");
+                    coefficient(k) = new_value;
+                    last = std::max<uint8_t>(last, k);
+                }
+            }
+        }
+        if (eobrun_ > 0) {
+            for (; k <= scan.se; ++k) {
+                if (coefficient(k) != 0) {
+                    Refine(coefficient(k));
+                }
+            }
+            --eobrun_;
+            ++counters_.eob_blocks;
+        }
+    }
+
+    // Reads block (x, y) of channel |id|.
+    void ReadBlock(size_t id, size_t x, size_t y) {
+        const ScanInfo& scan = data_.scan;
+        auto& channel = data_.channels[id];
+        int16_t* block = channel.Block(x, y);
+        uint8_t& last = channel.LastNonzero(x, y);
+        ++counters_.blocks;
+        if (!data_.progressive) {
+            ReadDU(data_.dc[channel.dc_id].tree, data_.ac[channel.ac_id].tree, predictions_[id], block,
+                   last);
+        } else if (scan.ss == 0) {
+            if (scan.ah == 0) {
+                ReadDCFirst(data_.dc[channel.dc_id].tree, predictions_[id], block);
+            } else {
+                ReadDCRefine(block);
+            }
+        } else if (scan.ah == 0) {
+            ReadACFirst(data_.ac[channel.ac_id].tree, block, last);
+        } else {
+            ReadACRefine(data_.ac[channel.ac_id].tree, block, last);
+        }
+    }
+
+    // Reads an MCU of |Channels| channels, the first of which has |W| x |H|
+    // blocks and the others one each. Channels == 0 takes any layout.
+    template <size_t Channels, size_t W, size_t H>
+    void ReadMCU(size_t mcu) {
+        const ScanInfo& scan = data_.scan;
+        ++counters_.mcus;
+        size_t mcu_x = mcu % scan.mcu_x_cnt;
+        size_t mcu_y = mcu / scan.mcu_x_cnt;
+        if constexpr (Channels == 0) {
+            for (auto id : scan.channels) {
+                auto& channel = data_.channels[id];
+                for (size_t k = 0; k < channel.du_per_mcu; ++k) {
+                    ReadBlock(id, mcu_x * channel.du_w + k % channel.du_w, mcu_y * channel.du_h + k / channel.du_w);
+                }
+            }
+        } else {
+            for (size_t k = 0; k < W * H; ++k) {
+                ReadBlock(scan.channels[0], mcu_x * W + k % W, mcu_y * H + k / W);
+            }
+            for (size_t i = 1; i < Channels; ++i) {
+                ReadBlock(scan.channels[i], mcu_x, mcu_y);
             }
         }
     }
 
+    // Calls |read| with ReadMCU of the scan's layout, which is chosen once for
+    // the MCUs |read| goes through.
+    template <class Read>
+    void WithLayout(Read&& read) {
+        switch (data_.scan.layout) {
+            case MCULayout::Single:
+                return read([this](size_t mcu) { ReadMCU<1, 1, 1>(mcu); });
+            case MCULayout::YCbCr444:
+                return read([this](size_t mcu) { ReadMCU<3, 1, 1>(mcu); });
+            case MCULayout::YCbCr422:
+                return read([this](size_t mcu) { ReadMCU<3, 2, 1>(mcu); });
+            case MCULayout::YCbCr420:
+                return read([this](size_t mcu) { ReadMCU<3, 2, 2>(mcu); });
+            case MCULayout::YCbCr440:
+                return read([this](size_t mcu) { ReadMCU<3, 1, 2>(mcu); });
+            case MCULayout::Generic:
+                return read([this](size_t mcu) { ReadMCU<0, 0, 0>(mcu); });
+        }
+    }
+
+    void Restart() {
+        reader_.Restart(next_restart_);
+        next_restart_ = (next_restart_ + 1) % 8;
+        std::fill(predictions_.begin(), predictions_.end(), 0);
+        eobrun_ = 0;
+    }
+
 public:
-    MCUReader(StreamNavigator stream, DecoderData& data) : reader_(stream), data_(data) {
+    // Position in the scan between reads, restoring it repeats the reads made after it.
+    struct Checkpoint {
+        BitReader reader;
+        std::array<int64_t, 3> predictions;
+        size_t next_restart;
+        size_t eobrun;
+        size_t skip_end;
+        DecodeCounters counters;
+    };
+
+    MCUReader(StreamNavigator stream, DecoderData& data)
+        : reader_(stream), data_(data) {
     }
+    ~MCUReader() {
+        data_.stats.AddCounters(counters_);
+    }
+    // Rows after the last one the region needs are not read.
     void ReadData() {
-        // std::cout << data_.mcu_cnt << std::endl;
-        for (size_t i = 0; i < data_.mcu_cnt; ++i) {
-            ReadMCU();
-            // std::cout << std::endl << i + 1 << " MCU readed " << std::endl;
+        const ScanInfo& scan = data_.scan;
+        for (size_t row = 0; row < scan.needed.y_end; ++row) {
+            {
+                StageTimer timer(data_.stats, DecodeStage::EntropyDecode);
+                ReadMCUs(row * scan.mcu_x_cnt, std::min((row + 1) * scan.mcu_x_cnt, scan.mcu_cnt));
+            }
+            if (!data_.full_frame) {
+                data_.ScheduleMCURow(row);
+            }
         }
     }
-};
\ No newline at end of file
+    // Reads MCUs [begin, end) of the scan, passing restart markers on the way.
+    // Intervals without MCUs the region needs are skipped up to their markers.
+    void ReadMCUs(size_t begin, size_t end) {
+        WithLayout([&](auto read_mcu) { ReadMCUs(begin, end, read_mcu); });
+    }
+    template <class ReadMCUFunction>
+    void ReadMCUs(size_t begin, size_t end, ReadMCUFunction read_mcu) {
+        const ScanInfo& scan = data_.scan;
+        size_t interval = data_.restart_interval;
+        for (size_t i = begin; i < end; ++i) {
+            if (interval != 0 && i % interval == 0) {
+                if (i != 0) {
+                    // Data of the skipped interval may have arrived after the skip.
+                    if (i == skip_end_) {
+                        reader_.SkipInterval();
+                    }
+                    Restart();
+                }
+                size_t interval_end = std::min(i + interval, scan.mcu_cnt);
+                if (!scan.Needs(i, interval_end)) {
+                    reader_.SkipInterval();
+                    skip_end_ = interval_end;
+                }
+            }
+            if (i >= skip_end_) {
+                read_mcu(i);
+            }
+        }
+    }
+
+    Checkpoint Save() const {
+        return {reader_, predictions_, next_restart_, eobrun_, skip_end_, counters_};
+    }
+    void Restore(const Checkpoint& checkpoint) {
+        reader_ = checkpoint.reader;
+        predictions_ = checkpoint.predictions;
+        next_restart_ = checkpoint.next_restart;
+        eobrun_ = checkpoint.eobrun;
+        skip_end_ = checkpoint.skip_end;
+        counters_ = checkpoint.counters;
+    }
+    void Resume(StreamNavigator stream) {
+        reader_.Resume(stream);
+    }
+    size_t Position() const {
+        return reader_.Position();
+    }
+    bool Starved() const {
+        return reader_.Starved();
+    }
+
+    // Reads MCUs [begin, end) which form a single restart interval.
+    void ReadInterval(size_t begin, size_t end) {
+        WithLayout([&](auto read_mcu) {
+            for (size_t i = begin; i < end; ++i) {
+                read_mcu(i);
+            }
+        });
+    }
+};
+
+// Entropy decodes restart intervals of the scan concurrently, each of them
+// writes to its own MCU range. Intervals the region does not need are skipped.
+// |restarts| are stream offsets of the scan's restart markers from the marker index.
+inline void ReadDataParallel(StreamNavigator stream, std::span<const size_t> restarts, DecoderData& data) {
+    size_t interval = data.restart_interval;
+    size_t mcu_cnt = data.scan.mcu_cnt;
+    size_t intervals_cnt = (mcu_cnt + interval - 1) / interval;
+    size_t offset = stream.Offset();
+    DATA_ERROR_IF(restarts.size() + 1 < intervals_cnt, "Not enough restart markers.");
+    for (size_t i = 0; i + 1 < intervals_cnt; ++i) {
+        DATA_ERROR_IF(stream.Data()[restarts[i] - offset + 1] != 0xd0 + i % 8, "Wrong restart marker.");
+    }
+
+    auto read_intervals = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            size_t begin = (i == 0 ? 0 : restarts[i - 1] - offset + 2);
+            size_t end = (i < restarts.size() ? restarts[i] - offset : stream.Size());
+            size_t mcu_end = std::min((i + 1) * interval, mcu_cnt);
+            if (!data.scan.Needs(i * interval, mcu_end)) {
+                continue;
+            }
+            StreamNavigator interval_stream = stream;
+            interval_stream.MoveBegin(begin);
+            interval_stream.Truncate(end - begin);
+            MCUReader reader(interval_stream, data);
+            reader.ReadInterval(i * interval, mcu_end);
+        }
+    };
+
+    // A few tasks per thread let the pool balance intervals of uneven cost.
+    ThreadPool& pool = data.Pool();
+    size_t tasks = std::min(intervals_cnt, (pool.Workers() + 1) * 4);
+    pool.ParallelFor(tasks, [&](size_t i) {
+        StageTimer timer(data.stats, DecodeStage::EntropyDecode);
+        read_intervals(intervals_cnt * i / tasks, intervals_cnt * (i + 1) / tasks);
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "STDInclude.h"
+
+// Read only contents of a whole file. The file is memory mapped where the
+// platform supports it and read into memory otherwise.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const uint8_t> Data() const {
+        return {data_, size_};
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<uint8_t> buffer_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "STDInclude.h"
+#include "Arena.h"
+
+// Segment of the stream starting with a marker, the segment of a scan spans
+// its entropy coded data as well.
+struct MarkerEntry {
+    uint8_t marker;
+    // Offset of the 0xff of the marker.
+    size_t begin;
+    // Offset after the segment.
+    size_t end;
+};
+
+// Whether a segment length follows the marker.
+inline bool HasLength(uint8_t marker) {
+    return marker != 0xd8 && marker != 0xd9;
+}
+
+// Returns offset of the marker ending entropy coded data [begin, size), or
+// |size| if the data ends first. Offsets of the restart markers on the way are
+// passed to |on_restart|. 0xff bytes are found with memchr, which libc
+// vectorizes, so bytes between them are not looked at one by one.
+template <class OnRestart>
+size_t FindScanEnd(const uint8_t* data, size_t begin, size_t size, OnRestart&& on_restart) {
+    for (size_t i = begin; i + 1 < size;) {
+        const void* found = std::memchr(data + i, 0xff, size - 1 - i);
+        if (!found) {
+            break;
+        }
+        i = static_cast<const uint8_t*>(found) - data;
+        uint8_t next = data[i + 1];
+        if (0xd0 <= next && next <= 0xd7) {
+            on_restart(i);
+        } else if (next != 0) {
+            return i;
+        }
+        i += 2;
+    }
+    return size;
+}
+
+// Markers of a stream in file order and restart markers of its scans, both
+// kept in the arena of the decode.
+struct MarkerIndex {
+    std::span<MarkerEntry> markers;
+    // Offsets of RSTn markers in the stream, ascending.
+    std::span<size_t> restarts;
+
+    // Restart markers in [begin, end) of the stream.
+    std::span<const size_t> RestartsIn(size_t begin, size_t end) const {
+        auto first = std::lower_bound(restarts.begin(), restarts.end(), begin);
+        auto last = std::lower_bound(first, restarts.end(), end);
+        return {first, last};
+    }
+};
+
+// Indexes markers of |data| in a single pass up to the end of image marker.
+// With |headers_only| the index stops at the first scan, whose entry ends with
+// its marker.
+MarkerIndex BuildMarkerIndex(std::span<const uint8_t> data, Arena& arena, bool headers_only = false);
@@ -1,7 +1,14 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <algorithm>
 #include <vector>
+#include <array>
+#include <span>
+#include <string>
 #include <memory>
 #include <stdexcept>
 #include <iomanip>
@@ -1,7 +1,7 @@
 #pragma once
 #include "StreamNavigator.h"
 #include "Exceptions.h"
-#include <memory>
+#include "MarkerIndex.h"
 
 struct DecoderData;
 
@@ -13,73 +13,16 @@ enum class SectionType {
     DQT,
     ImageInfo,
     Huffman,
+    RestartInterval,
     ImageData,
     End
 };
 std::string SectionTypeToString(SectionType type);
+// Type of the section starting with |marker|, None for markers the decoder does not know.
+SectionType MarkerSectionType(uint8_t marker);
 
-class SearchEndStrategy {
-private:
-public:
-    SearchEndStrategy() = default;
-    virtual ~SearchEndStrategy() = default;
-    virtual size_t FindEnd(StreamNavigator& stream, size_t begin, size_t& end, size_t& length) {
-        (void)stream;
-        (void)begin;
-        (void)end;
-        (void)length;
-        SECTION_ERROR_IF(true, "Wrong strategy.");
-    }
-};
-
-class SimpleSearch : public SearchEndStrategy {
-public:
-    virtual size_t FindEnd(StreamNavigator& stream, size_t begin, size_t& end,
-                           size_t& length) override {
-        SECTION_ERROR_IF(begin + 2 > stream.Size(), "Section to small for SS strategy.");
-        length = 0;
-        end = begin + 2;
-        stream.SetBoundaries(begin + 2, end);
-        return end;
-    }
-};
-class FixedLengthSearch : public SearchEndStrategy {
-public:
-    virtual size_t FindEnd(StreamNavigator& stream, size_t begin, size_t& end,
-                           size_t& length) override {
-        SECTION_ERROR_IF(begin + 4 > stream.Size(), "Section to small for FLS strategy.");
-        size_t len = (stream[begin + 2] << 8) + stream[begin + 3];
-        end = begin + len + 2;
-        SECTION_ERROR_IF(end > stream.Size(), "Section to small for FLS specified length.");
-        length = len - 2;
-        stream.SetBoundaries(begin + 4, end);
-        return end;
-    }
-};
-class FixedLengthTillSearch : public SearchEndStrategy {
-public:
-    virtual size_t FindEnd(StreamNavigator& stream, size_t begin, size_t& end,
-                           size_t& length) override {
-        SECTION_ERROR_IF(begin + 4 > stream.Size(), "Section to small for FLTS strategy.");
-        size_t len = (stream[begin + 2] << 8) + stream[begin + 3];
-        end = begin;
-        for (size_t i = begin + len + 2; i < stream.Size(); ++i) {
-            if (stream[i] != 0xff) {
-                continue;
-            }
-            if (i + 1 < stream.Size() && stream[i + 1] == 0) {
-                continue;
-            }
-            end = i;
-            break;
-        }
-        SECTION_ERROR_IF(end == begin, "Failed to find end of section with FLTS strategy.");
-        length = len - 2;
-        stream.SetBoundaries(begin + 4, end);
-        return end;
-    }
-};
-
+// Segment of the stream, its bounds come from the marker index, so the section
+// only holds a window of its payload.
 class Section {
 private:
     const SectionType type_;
@@ -87,23 +30,25 @@ private:
 protected:
     StreamNavigator stream_;
     size_t begin_, end_;
-    size_t length_;
-    std::shared_ptr<SearchEndStrategy> search_end_strategy_;
 
 public:
     std::string Info() const {
         return SectionTypeToString(type_) + " (" + std::to_string(begin_) + ", " +
                std::to_string(end_) + ")";
     }
-    Section(SectionType type, StreamNavigator stream, size_t begin,
-            std::shared_ptr<SearchEndStrategy> strategy)
-        : type_(type), stream_(stream), begin_(begin), search_end_strategy_(strategy) {
+    Section(SectionType type, StreamNavigator stream, const MarkerEntry& entry)
+        : type_(type), stream_(stream), begin_(entry.begin), end_(entry.end) {
+        size_t payload = begin_ + (HasLength(entry.marker) ? 4 : 2);
+        stream_.SetBoundaries(std::min(payload, end_), end_);
     }
     SectionType Type() const {
         return type_;
     }
-    size_t FindEnd() {
-        return search_end_strategy_->FindEnd(stream_, begin_, end_, length_);
+    size_t Begin() const {
+        return begin_;
+    }
+    size_t End() const {
+        return end_;
     }
 
     virtual ~Section() {
@@ -115,56 +60,68 @@ public:
 
 class BeginSection : public Section {
 public:
-    BeginSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::Begin, stream, begin, std::make_shared<SimpleSearch>()) {
+    BeginSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::Begin, stream, entry) {
     }
 };
 class EndSection : public Section {
 public:
-    EndSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::End, stream, begin, std::make_shared<SimpleSearch>()) {
+    EndSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::End, stream, entry) {
     }
 };
 
 class CommentSection : public Section {
 public:
-    CommentSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::Comment, stream, begin, std::make_shared<FixedLengthSearch>()) {
+    CommentSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::Comment, stream, entry) {
     }
     virtual void Process(DecoderData& data) override;
 };
 class ApplicationSection : public Section {
 public:
-    ApplicationSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::Application, stream, begin, std::make_shared<FixedLengthSearch>()) {
+    ApplicationSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::Application, stream, entry) {
     }
 };
 class DQTSection : public Section {
 public:
-    DQTSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::DQT, stream, begin, std::make_shared<FixedLengthSearch>()) {
+    DQTSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::DQT, stream, entry) {
     }
     virtual void Process(DecoderData& data) override;
 };
 class ImageInfoSection : public Section {
 public:
-    ImageInfoSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::ImageInfo, stream, begin, std::make_shared<FixedLengthSearch>()) {
+    ImageInfoSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::ImageInfo, stream, entry), progressive_(entry.marker == 0xc2) {
     }
     virtual void Process(DecoderData& data) override;
+
+private:
+    bool progressive_;
 };
 class HuffmanSection : public Section {
 public:
-    HuffmanSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::Huffman, stream, begin, std::make_shared<FixedLengthSearch>()) {
+    HuffmanSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::Huffman, stream, entry) {
+    }
+    virtual void Process(DecoderData& data) override;
+};
+class RestartIntervalSection : public Section {
+public:
+    RestartIntervalSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::RestartInterval, stream, entry) {
     }
     virtual void Process(DecoderData& data) override;
 };
 class ImageDataSection : public Section {
 public:
-    ImageDataSection(StreamNavigator stream, size_t begin)
-        : Section(SectionType::ImageData, stream, begin,
-                  std::make_shared<FixedLengthTillSearch>()) {
+    // The section spans the entropy coded data if the entry does.
+    ImageDataSection(StreamNavigator stream, const MarkerEntry& entry)
+        : Section(SectionType::ImageData, stream, entry) {
     }
     virtual void Process(DecoderData& data) override;
+    // Reads the scan header and starts the scan, leaves the entropy coded data.
+    void ProcessHeader(DecoderData& data);
 };
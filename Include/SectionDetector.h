@@ -4,11 +4,11 @@
 class SectionDetecter {
 private:
     StreamNavigator stream_;
-    size_t pos_ = 0;
-
-    std::shared_ptr<Section> CreateCurrentSection();
 
 public:
     SectionDetecter(const StreamNavigator& stream);
+    // Creates section of the marker |entry| in |arena|.
+    Section* CreateSection(const MarkerEntry& entry, Arena& arena);
+    // Indexes markers of the stream and creates their sections sorted for processing.
     void GetSections(DecoderData& dec);
 };
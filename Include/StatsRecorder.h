@@ -0,0 +1,71 @@
+#pragma once
+
+#include "STDInclude.h"
+#include "DecodeStats.h"
+#include <chrono>
+#include <mutex>
+
+// Counters of an entropy reader, added to the stats once it is done.
+struct DecodeCounters
+{
+    size_t mcus       = 0;
+    size_t blocks     = 0;
+    size_t eob_blocks = 0;
+};
+
+// Collects DecodeStats of a decode from the threads working on it. Nothing is
+// recorded and no clock is read unless the options ask for stats.
+class StatsRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Clears |stats| and starts the clock of the decode, a null |stats| disables recording.
+    void Begin(DecodeStats* stats);
+    // Sets the wall time of the decode.
+    void Finish();
+
+    bool Enabled() const { return stats_ != nullptr; }
+
+    void AddStage(DecodeStage stage, Clock::time_point begin, Clock::time_point end);
+    void AddCounters(const DecodeCounters& counters);
+    void SetBytesConsumed(size_t bytes);
+    // Raises the peaks to the buffers in use.
+    void UpdateMemory(size_t coefficient_bytes, size_t pixel_bytes);
+
+private:
+    DecodeStats*                 stats_ = nullptr;
+    Clock::time_point            start_;
+    std::mutex                   mutex_;
+    // Threads of the events, the index of a thread is its number in the trace.
+    std::vector<std::thread::id> threads_;
+};
+
+// Times its scope as |stage| of the decode.
+class StageTimer
+{
+public:
+    StageTimer(StatsRecorder& recorder, DecodeStage stage)
+        : recorder_(recorder.Enabled() ? &recorder : nullptr), stage_(stage)
+    {
+        if (recorder_)
+        {
+            begin_ = StatsRecorder::Clock::now();
+        }
+    }
+    ~StageTimer()
+    {
+        if (recorder_)
+        {
+            recorder_->AddStage(stage_, begin_, StatsRecorder::Clock::now());
+        }
+    }
+
+    StageTimer(const StageTimer&)            = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    StatsRecorder*                   recorder_;
+    DecodeStage                      stage_;
+    StatsRecorder::Clock::time_point begin_;
+};
@@ -2,21 +2,30 @@
 
 #include "Exceptions.h"
 
+// Window into memory owned by someone else, the memory must outlive the navigator.
 class StreamNavigator {
 private:
-    const std::vector<uint8_t>& data_;
+    std::span<const uint8_t> data_;
     size_t beg_ = 0;
     size_t end_ = 0;
 
 public:
-    StreamNavigator(const std::vector<uint8_t>& data) : data_(data) {
+    StreamNavigator(std::span<const uint8_t> data) : data_(data) {
         end_ = data_.size();
     }
     int operator[](size_t id) {
-        return data_.at(beg_ + id);
+        DATA_ERROR_IF(beg_ + id >= data_.size(), "Unexpected end of data.");
+        return data_[beg_ + id];
+    }
+    const uint8_t* Data() const {
+        return data_.data() + beg_;
+    }
+    // Offset of the window in the whole data.
+    size_t Offset() const {
+        return beg_;
     }
     int Bit(size_t id) {
-        uint8_t tmp = data_.at(beg_ + id / 8);
+        uint8_t tmp = (*this)[id / 8];
         return ((tmp >> (7 - id % 8)) & 1);
     }
     size_t Size() {
@@ -31,6 +40,10 @@ public:
         beg_ = beg;
         end_ = end;
     }
+    void Truncate(size_t size) {
+        THROW_IF(size > end_ - beg_, "Invalid truncate size.");
+        end_ = beg_ + size;
+    }
     void MoveBegin(size_t delta) {
         THROW_IF(delta + beg_ > end_, "Invalid move delta.");
         beg_ += delta;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "STDInclude.h"
+#include "Image.h"
+#include "DecodeOptions.h"
+#include "Decoder.h"
+
+// Push based decoder for data arriving in chunks. Pixel rows are handed out as
+// soon as the data they depend on is fed, so decoding overlaps the transfer.
+// Restart intervals are always decoded sequentially.
+class StreamingDecoder
+{
+public:
+    // Called with finished rows [first_row, first_row + rows.height) of the image.
+    using RowsCallback = std::function<void(const PixelView& rows, size_t first_row)>;
+    // Called after scan |scan| of a frame made of several scans, |image| is
+    // rendered from the coefficients read so far.
+    using ScanCallback = std::function<void(const PixelView& image, size_t scan)>;
+
+    explicit StreamingDecoder(const DecodeOptions& options = {});
+    ~StreamingDecoder();
+
+    StreamingDecoder(const StreamingDecoder&)            = delete;
+    StreamingDecoder& operator=(const StreamingDecoder&) = delete;
+
+    void SetRowsCallback(RowsCallback callback);
+    // Every scan costs a pass over the whole image when it is set.
+    void SetScanCallback(ScanCallback callback);
+
+    // Appends |chunk| to the data and decodes as far as it allows.
+    void Feed(std::span<const uint8_t> chunk);
+    // Tells there is no more data, throws if the image is not complete.
+    void Finish();
+
+    // Headers up to the first scan header are read, tables may follow the
+    // frame header, so the frame is set up only then.
+    bool              HasInfo() const;
+    const OutputInfo& Info() const;
+    bool              Done() const;
+    // Hands over the decoded image once Done().
+    Image             TakeImage();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
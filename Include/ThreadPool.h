@@ -0,0 +1,219 @@
+#pragma once
+
+#include "STDInclude.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+struct ThreadPoolOptions {
+    // Worker threads, a thread waiting for tasks runs them as well. 0 picks
+    // hardware_concurrency() - 1.
+    size_t threads = 0;
+    // Runs every task on the thread which submits it, no workers are started.
+    bool inline_only = false;
+    // CPUs workers are pinned to in round robin order, empty leaves them unpinned.
+    std::vector<size_t> affinity;
+
+    // Options of a pool running every task on the submitting thread.
+    static ThreadPoolOptions Inline() {
+        ThreadPoolOptions options;
+        options.inline_only = true;
+        return options;
+    }
+    // Options of a pool of |threads| unpinned workers.
+    static ThreadPoolOptions Threads(size_t threads) {
+        ThreadPoolOptions options;
+        options.threads = threads;
+        return options;
+    }
+};
+
+// Callable queued by the pool. Callables of up to kInlineSize bytes, which
+// all tasks of a decode are, are kept in place, so queuing them does not
+// allocate. Larger ones are moved to the heap.
+class Task {
+public:
+    static constexpr size_t kInlineSize = 48;
+
+    Task() = default;
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& callable) {
+        using Callable = std::decay_t<F>;
+        if constexpr (sizeof(Callable) <= kInlineSize && alignof(Callable) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Callable>) {
+            new (storage_) Callable(std::forward<F>(callable));
+            call_ = [](void* storage) { (*static_cast<Callable*>(storage))(); };
+            manage_ = [](void* storage, void* destination) {
+                auto* object = static_cast<Callable*>(storage);
+                if (destination) {
+                    new (destination) Callable(std::move(*object));
+                }
+                object->~Callable();
+            };
+        } else {
+            new (storage_) Callable*(new Callable(std::forward<F>(callable)));
+            call_ = [](void* storage) { (**static_cast<Callable**>(storage))(); };
+            manage_ = [](void* storage, void* destination) {
+                auto* pointer = static_cast<Callable**>(storage);
+                if (destination) {
+                    new (destination) Callable*(*pointer);
+                } else {
+                    delete *pointer;
+                }
+            };
+        }
+    }
+    ~Task() {
+        Reset();
+    }
+
+    Task(Task&& other) noexcept {
+        *this = std::move(other);
+    }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            if (other.manage_) {
+                other.manage_(other.storage_, storage_);
+                call_ = std::exchange(other.call_, nullptr);
+                manage_ = std::exchange(other.manage_, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    explicit operator bool() const {
+        return call_ != nullptr;
+    }
+    void operator()() {
+        call_(storage_);
+    }
+
+private:
+    void Reset() {
+        if (manage_) {
+            manage_(storage_, nullptr);
+            call_ = nullptr;
+            manage_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    void (*call_)(void*) = nullptr;
+    // Moves the callable to |destination| and destroys it, only destroys it if that is null.
+    void (*manage_)(void*, void*) = nullptr;
+};
+
+// Pool with a task queue per worker. Workers run their own newest tasks first
+// and steal the oldest ones of the others when they run out of them.
+class ThreadPool {
+public:
+    explicit ThreadPool(const ThreadPoolOptions& options = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool shared by decodes which do not specify their own.
+    static ThreadPool& Default();
+
+    size_t Workers() const {
+        return workers_.size();
+    }
+
+    // Runs body(i) for every i in [0, count) and waits for all of them.
+    template <class Body>
+    void ParallelFor(size_t count, const Body& body);
+
+private:
+    friend class TaskGroup;
+
+    // Ring of tasks, its slots are reused and only grow when all of them are taken.
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Task> slots = std::vector<Task>(64);
+        size_t head = 0;
+        size_t size = 0;
+
+        void PushBack(Task task);
+        Task PopBack();
+        Task PopFront();
+    };
+
+    void Submit(Task task);
+    // Runs a single queued task, returns false if there were none.
+    bool RunPending();
+    void WorkerLoop(size_t id);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    // Tasks in the queues, changed under the lock of the queue holding the task.
+    std::atomic<size_t> queued_ = 0;
+    std::atomic<size_t> next_queue_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
+
+// Tasks waited for together. The first exception thrown by them is rethrown by Wait.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool);
+    // Waits for the tasks dropping their errors.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <class F>
+    void Run(F&& task);
+    // Runs queued tasks of the pool while tasks of the group are not finished.
+    void Wait();
+
+private:
+    template <class F>
+    void Execute(F& task);
+    void SetError(std::exception_ptr error);
+    // Counts a task submitted to the pool as finished.
+    void Finish();
+
+    ThreadPool& pool_;
+    std::atomic<size_t> pending_ = 0;
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::exception_ptr error_;
+};
+
+template <class F>
+void TaskGroup::Run(F&& task) {
+    if (pool_.Workers() == 0) {
+        Execute(task);
+        return;
+    }
+    ++pending_;
+    pool_.Submit([this, task = std::forward<F>(task)]() mutable {
+        Execute(task);
+        Finish();
+    });
+}
+
+template <class F>
+void TaskGroup::Execute(F& task) {
+    try {
+        task();
+    } catch (...) {
+        SetError(std::current_exception());
+    }
+}
+
+template <class Body>
+void ThreadPool::ParallelFor(size_t count, const Body& body) {
+    TaskGroup group(*this);
+    for (size_t i = 0; i < count; ++i) {
+        group.Run([&body, i]() { body(i); });
+    }
+    group.Wait();
+}
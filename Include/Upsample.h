@@ -0,0 +1,24 @@
+#pragma once
+
+#include "STDInclude.h"
+
+enum class UpsamplingMode {
+    // Every chroma sample is replicated to the pixels it covers.
+    Nearest = 0,
+    // Triangle filter, same as libjpeg "fancy" upsampling.
+    Fancy
+};
+
+// Row kernels, which read |width| input samples and write 2 * |width| output ones.
+void UpsampleH2(const uint8_t* input, uint8_t* output, size_t width);
+// Requires |width| > 2, libjpeg replicates samples of narrower rows.
+void UpsampleH2Fancy(const uint8_t* input, uint8_t* output, size_t width);
+// |nearest| is the input row the output row lies in, |farthest| is the adjacent
+// row on the side of the output row. Requires |width| > 2 as well.
+void UpsampleH2V2Fancy(const uint8_t* nearest, const uint8_t* farthest, uint8_t* output,
+                       size_t width);
+
+// Vertical only kernel, which writes |width| samples. |lower| tells whether the
+// output row is the lower one of the pair produced from |nearest|.
+void UpsampleV2Fancy(const uint8_t* nearest, const uint8_t* farthest, uint8_t* output,
+                     size_t width, bool lower);
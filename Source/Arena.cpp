@@ -0,0 +1,84 @@
+#include "Arena.h"
+
+namespace {
+
+constexpr size_t kHeaderSize = 64;
+
+}  // namespace
+
+Arena::~Arena() {
+    Reset();
+    FreeBlocks();
+}
+
+Arena::Arena(Arena&& other) noexcept {
+    *this = std::move(other);
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        FreeBlocks();
+        blocks_ = std::exchange(other.blocks_, nullptr);
+        current_ = std::exchange(other.current_, nullptr);
+        left_ = std::exchange(other.left_, 0);
+        finalizers_ = std::exchange(other.finalizers_, nullptr);
+        heap_allocations_ = other.heap_allocations_;
+    }
+    return *this;
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    if (!blocks_ || padding + size > left_) {
+        AddBlock(std::max(size + alignment, kMinBlockSize));
+        padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    }
+    void* result = current_ + padding;
+    current_ += padding + size;
+    left_ -= padding + size;
+    return result;
+}
+
+void Arena::Reset() {
+    for (; finalizers_; finalizers_ = finalizers_->next) {
+        finalizers_->destroy(finalizers_->object);
+    }
+    if (!blocks_) {
+        return;
+    }
+    // A single block holding everything the last decode needed.
+    size_t total = 0;
+    for (Block* block = blocks_; block; block = block->next) {
+        total += block->size;
+    }
+    if (blocks_->next) {
+        FreeBlocks();
+        AddBlock(total);
+        return;
+    }
+    current_ = reinterpret_cast<char*>(blocks_) + kHeaderSize;
+    left_ = blocks_->size;
+}
+
+void Arena::AddBlock(size_t size) {
+    // Blocks grow geometrically, so a decode needs only a few of them.
+    if (blocks_) {
+        size = std::max(size, 2 * blocks_->size);
+    }
+    auto* block = static_cast<Block*>(::operator new(kHeaderSize + size));
+    ++heap_allocations_;
+    block->next = blocks_;
+    block->size = size;
+    blocks_ = block;
+    current_ = reinterpret_cast<char*>(block) + kHeaderSize;
+    left_ = size;
+}
+
+void Arena::FreeBlocks() {
+    while (blocks_) {
+        ::operator delete(std::exchange(blocks_, blocks_->next));
+    }
+    current_ = nullptr;
+    left_ = 0;
+}
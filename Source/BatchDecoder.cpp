@@ -0,0 +1,76 @@
+#include "BatchDecoder.h"
+
+BatchDecoder::BatchDecoder(ThreadPool& pool) : pool_(pool), inline_pool_(ThreadPoolOptions::Inline()), tasks_(pool) {}
+
+BatchDecoder::~BatchDecoder() = default;
+
+std::vector<std::future<Image>> BatchDecoder::Decode(std::span<const std::span<const uint8_t>> inputs,
+                                                     const DecodeOptions&                       options)
+{
+    std::vector<std::shared_ptr<std::promise<Image>>> promises(inputs.size());
+    std::vector<std::future<Image>>                   futures(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        promises[i] = std::make_shared<std::promise<Image>>();
+        futures[i]  = promises[i]->get_future();
+    }
+    Decode(inputs, options, [promises = std::move(promises)](size_t index, Image image, std::exception_ptr error) {
+        if (error)
+        {
+            promises[index]->set_exception(error);
+        }
+        else
+        {
+            promises[index]->set_value(std::move(image));
+        }
+    });
+    return futures;
+}
+
+void BatchDecoder::Decode(std::span<const std::span<const uint8_t>> inputs, const DecodeOptions& options,
+                          Callback callback)
+{
+    DecodeOptions image_options = options;
+    image_options.thread_pool   = &inline_pool_;
+    image_options.stats         = nullptr;
+    auto shared_callback        = std::make_shared<Callback>(std::move(callback));
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        tasks_.Run([this, input = inputs[i], i, image_options, shared_callback]() {
+            auto               context = AcquireContext();
+            Image              image;
+            std::exception_ptr error;
+            try
+            {
+                image = context->Decode(input, image_options);
+            } catch (...)
+            {
+                error = std::current_exception();
+            }
+            ReleaseContext(std::move(context));
+            (*shared_callback)(i, std::move(image), error);
+        });
+    }
+}
+
+void BatchDecoder::Wait() { tasks_.Wait(); }
+
+std::unique_ptr<DecoderContext> BatchDecoder::AcquireContext()
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (!idle_contexts_.empty())
+        {
+            auto context = std::move(idle_contexts_.back());
+            idle_contexts_.pop_back();
+            return context;
+        }
+    }
+    return std::make_unique<DecoderContext>();
+}
+
+void BatchDecoder::ReleaseContext(std::unique_ptr<DecoderContext> context)
+{
+    std::lock_guard lock(mutex_);
+    idle_contexts_.push_back(std::move(context));
+}
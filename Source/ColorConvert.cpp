@@ -0,0 +1,88 @@
+#include "ColorConvert.h"
+
+namespace {
+
+uint8_t Clamp(int32_t value) {
+    return std::clamp(value, 0, 255);
+}
+
+size_t ScalarYCbCrToPixels(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* output,
+                           size_t width, PixelFormat format) {
+    size_t pixel_size = BytesPerPixel(format);
+    size_t r_id = format == PixelFormat::BGR8 ? 2 : 0;
+    for (size_t x = 0; x < width; ++x, output += pixel_size) {
+        int32_t luma = y[x];
+        int32_t blue = cb[x] - 128;
+        int32_t red = cr[x] - 128;
+        output[r_id] = Clamp(luma + ((color::kCrToR * red + color::kHalf) >> color::kScaleBits));
+        output[1] = Clamp(luma + ((color::kCbToG * blue + color::kCrToG * red + color::kHalf) >>
+                                  color::kScaleBits));
+        output[2 - r_id] = Clamp(luma + ((color::kCbToB * blue + color::kHalf) >> color::kScaleBits));
+        if (format == PixelFormat::RGBA8) {
+            output[3] = 255;
+        }
+    }
+    return width;
+}
+
+}  // namespace
+
+ColorRowKernel GetColorRowKernel(IDCTBackendType type) {
+    ColorRowKernel kernel = nullptr;
+    switch (type) {
+        case IDCTBackendType::Auto:
+            for (auto candidate :
+                 {IDCTBackendType::AVX2, IDCTBackendType::SSE41, IDCTBackendType::NEON}) {
+                kernel = GetColorRowKernel(candidate);
+                if (kernel != &ScalarYCbCrToPixels) {
+                    return kernel;
+                }
+            }
+            break;
+        case IDCTBackendType::SSE41:
+            kernel = CpuSupports(type) ? GetSSE41ColorRowKernel() : nullptr;
+            break;
+        case IDCTBackendType::AVX2:
+            kernel = CpuSupports(type) ? GetAVX2ColorRowKernel() : nullptr;
+            break;
+        case IDCTBackendType::NEON:
+            kernel = GetNEONColorRowKernel();
+            break;
+        default:
+            break;
+    }
+    return kernel ? kernel : &ScalarYCbCrToPixels;
+}
+
+void YCbCrToPixels(ColorRowKernel kernel, const uint8_t* y, const uint8_t* cb, const uint8_t* cr,
+                   uint8_t* output, size_t width, PixelFormat format) {
+    if (format == PixelFormat::Gray8) {
+        GrayToPixels(y, output, width, format);
+        return;
+    }
+    size_t done = kernel(y, cb, cr, output, width, format);
+    if (done < width) {
+        ScalarYCbCrToPixels(y + done, cb + done, cr + done, output + done * BytesPerPixel(format),
+                            width - done, format);
+    }
+}
+
+void GrayToPixels(const uint8_t* y, uint8_t* output, size_t width, PixelFormat format) {
+    switch (format) {
+        case PixelFormat::Gray8:
+            std::memcpy(output, y, width);
+            break;
+        case PixelFormat::RGB8:
+        case PixelFormat::BGR8:
+            for (size_t x = 0; x < width; ++x, output += 3) {
+                output[0] = output[1] = output[2] = y[x];
+            }
+            break;
+        case PixelFormat::RGBA8:
+            for (size_t x = 0; x < width; ++x, output += 4) {
+                output[0] = output[1] = output[2] = y[x];
+                output[3] = 255;
+            }
+            break;
+    }
+}
@@ -0,0 +1,87 @@
+#include "ColorConvert.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace {
+
+// Converts 8 pixels held in int32_t lanes, channels are left in int32_t lanes.
+void Convert(__m256i y, __m256i cb, __m256i cr, __m256i* rgb) {
+    const __m256i half = _mm256_set1_epi32(color::kHalf);
+    cb = _mm256_sub_epi32(cb, _mm256_set1_epi32(128));
+    cr = _mm256_sub_epi32(cr, _mm256_set1_epi32(128));
+    __m256i red = _mm256_add_epi32(_mm256_mullo_epi32(cr, _mm256_set1_epi32(color::kCrToR)), half);
+    __m256i green = _mm256_add_epi32(_mm256_mullo_epi32(cb, _mm256_set1_epi32(color::kCbToG)),
+                                     _mm256_mullo_epi32(cr, _mm256_set1_epi32(color::kCrToG)));
+    __m256i blue = _mm256_add_epi32(_mm256_mullo_epi32(cb, _mm256_set1_epi32(color::kCbToB)), half);
+    rgb[0] = _mm256_add_epi32(y, _mm256_srai_epi32(red, color::kScaleBits));
+    rgb[1] = _mm256_add_epi32(y, _mm256_srai_epi32(_mm256_add_epi32(green, half), color::kScaleBits));
+    rgb[2] = _mm256_add_epi32(y, _mm256_srai_epi32(blue, color::kScaleBits));
+}
+
+// Saturates 16 values from two vectors of int32_t lanes keeping their order.
+__m128i Pack(__m256i low, __m256i high) {
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xd8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+}
+
+size_t AVX2YCbCrToPixels(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* output,
+                         size_t width, PixelFormat format) {
+    size_t pixel_size = BytesPerPixel(format);
+    // Three byte pixels are written with 16 byte stores, which overrun by 4 bytes.
+    size_t slack = pixel_size == 3 ? 2 : 0;
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m128i drop_alpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t x = 0;
+    for (; x + 16 + slack <= width; x += 16, output += 16 * pixel_size) {
+        __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        __m128i blue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cb + x));
+        __m128i red = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cr + x));
+        __m256i low[3], high[3];
+        Convert(_mm256_cvtepu8_epi32(luma), _mm256_cvtepu8_epi32(blue), _mm256_cvtepu8_epi32(red),
+                low);
+        Convert(_mm256_cvtepu8_epi32(_mm_srli_si128(luma, 8)),
+                _mm256_cvtepu8_epi32(_mm_srli_si128(blue, 8)),
+                _mm256_cvtepu8_epi32(_mm_srli_si128(red, 8)), high);
+
+        __m128i first = Pack(low[0], high[0]);
+        __m128i green = Pack(low[1], high[1]);
+        __m128i third = Pack(low[2], high[2]);
+        if (format == PixelFormat::BGR8) {
+            std::swap(first, third);
+        }
+        __m128i pixels[4];
+        for (size_t half = 0; half < 2; ++half) {
+            __m128i first_green =
+                half ? _mm_unpackhi_epi8(first, green) : _mm_unpacklo_epi8(first, green);
+            __m128i third_alpha =
+                half ? _mm_unpackhi_epi8(third, alpha) : _mm_unpacklo_epi8(third, alpha);
+            pixels[2 * half] = _mm_unpacklo_epi16(first_green, third_alpha);
+            pixels[2 * half + 1] = _mm_unpackhi_epi16(first_green, third_alpha);
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            if (pixel_size == 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 16), pixels[i]);
+            } else {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 12),
+                                 _mm_shuffle_epi8(pixels[i], drop_alpha));
+            }
+        }
+    }
+    return x;
+}
+
+}  // namespace
+
+ColorRowKernel GetAVX2ColorRowKernel() {
+    return &AVX2YCbCrToPixels;
+}
+
+#else
+
+ColorRowKernel GetAVX2ColorRowKernel() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "ColorConvert.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+namespace {
+
+// Converts 4 pixels held in int32_t lanes to saturated int16_t ones.
+void Convert(int32x4_t y, int32x4_t cb, int32x4_t cr, int16x4_t* rgb) {
+    const int32x4_t half = vdupq_n_s32(color::kHalf);
+    int32x4_t red = vmlaq_n_s32(half, cr, color::kCrToR);
+    int32x4_t green = vmlaq_n_s32(vmlaq_n_s32(half, cb, color::kCbToG), cr, color::kCrToG);
+    int32x4_t blue = vmlaq_n_s32(half, cb, color::kCbToB);
+    rgb[0] = vqmovn_s32(vaddq_s32(y, vshrq_n_s32(red, color::kScaleBits)));
+    rgb[1] = vqmovn_s32(vaddq_s32(y, vshrq_n_s32(green, color::kScaleBits)));
+    rgb[2] = vqmovn_s32(vaddq_s32(y, vshrq_n_s32(blue, color::kScaleBits)));
+}
+
+size_t NEONYCbCrToPixels(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* output,
+                         size_t width, PixelFormat format) {
+    size_t pixel_size = BytesPerPixel(format);
+    const uint8x8_t center = vdup_n_u8(128);
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8, output += 8 * pixel_size) {
+        int16x8_t luma = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x)));
+        int16x8_t blue = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cb + x), center));
+        int16x8_t red = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cr + x), center));
+        int16x4_t low[3], high[3];
+        Convert(vmovl_s16(vget_low_s16(luma)), vmovl_s16(vget_low_s16(blue)),
+                vmovl_s16(vget_low_s16(red)), low);
+        Convert(vmovl_s16(vget_high_s16(luma)), vmovl_s16(vget_high_s16(blue)),
+                vmovl_s16(vget_high_s16(red)), high);
+
+        uint8x8_t first = vqmovun_s16(vcombine_s16(low[0], high[0]));
+        uint8x8_t green = vqmovun_s16(vcombine_s16(low[1], high[1]));
+        uint8x8_t third = vqmovun_s16(vcombine_s16(low[2], high[2]));
+        if (format == PixelFormat::BGR8) {
+            std::swap(first, third);
+        }
+        if (pixel_size == 4) {
+            uint8x8x4_t pixels = {{first, green, third, vdup_n_u8(255)}};
+            vst4_u8(output, pixels);
+        } else {
+            uint8x8x3_t pixels = {{first, green, third}};
+            vst3_u8(output, pixels);
+        }
+    }
+    return x;
+}
+
+}  // namespace
+
+ColorRowKernel GetNEONColorRowKernel() {
+    return &NEONYCbCrToPixels;
+}
+
+#else
+
+ColorRowKernel GetNEONColorRowKernel() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "ColorConvert.h"
+
+#if defined(__SSE4_1__)
+
+#include <smmintrin.h>
+
+namespace {
+
+// Converts 4 pixels held in int32_t lanes, channels are left in int32_t lanes.
+void Convert(__m128i y, __m128i cb, __m128i cr, __m128i* rgb) {
+    const __m128i half = _mm_set1_epi32(color::kHalf);
+    cb = _mm_sub_epi32(cb, _mm_set1_epi32(128));
+    cr = _mm_sub_epi32(cr, _mm_set1_epi32(128));
+    __m128i red = _mm_add_epi32(_mm_mullo_epi32(cr, _mm_set1_epi32(color::kCrToR)), half);
+    __m128i green = _mm_add_epi32(_mm_mullo_epi32(cb, _mm_set1_epi32(color::kCbToG)),
+                                  _mm_mullo_epi32(cr, _mm_set1_epi32(color::kCrToG)));
+    __m128i blue = _mm_add_epi32(_mm_mullo_epi32(cb, _mm_set1_epi32(color::kCbToB)), half);
+    rgb[0] = _mm_add_epi32(y, _mm_srai_epi32(red, color::kScaleBits));
+    rgb[1] = _mm_add_epi32(y, _mm_srai_epi32(_mm_add_epi32(green, half), color::kScaleBits));
+    rgb[2] = _mm_add_epi32(y, _mm_srai_epi32(blue, color::kScaleBits));
+}
+
+// Saturates 8 values from two vectors of int32_t lanes to the low half of the result.
+__m128i Pack(__m128i low, __m128i high) {
+    return _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128());
+}
+
+size_t SSE41YCbCrToPixels(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* output,
+                          size_t width, PixelFormat format) {
+    size_t pixel_size = BytesPerPixel(format);
+    // Three byte pixels are written with 16 byte stores, which overrun by 4 bytes.
+    size_t slack = pixel_size == 3 ? 2 : 0;
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m128i drop_alpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t x = 0;
+    for (; x + 8 + slack <= width; x += 8, output += 8 * pixel_size) {
+        __m128i luma = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x));
+        __m128i blue = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + x));
+        __m128i red = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + x));
+        __m128i low[3], high[3];
+        Convert(_mm_cvtepu8_epi32(luma), _mm_cvtepu8_epi32(blue), _mm_cvtepu8_epi32(red), low);
+        Convert(_mm_cvtepu8_epi32(_mm_srli_si128(luma, 4)), _mm_cvtepu8_epi32(_mm_srli_si128(blue, 4)),
+                _mm_cvtepu8_epi32(_mm_srli_si128(red, 4)), high);
+
+        __m128i first = Pack(low[0], high[0]);
+        __m128i green = Pack(low[1], high[1]);
+        __m128i third = Pack(low[2], high[2]);
+        if (format == PixelFormat::BGR8) {
+            std::swap(first, third);
+        }
+        __m128i first_green = _mm_unpacklo_epi8(first, green);
+        __m128i third_alpha = _mm_unpacklo_epi8(third, alpha);
+        __m128i pixels_low = _mm_unpacklo_epi16(first_green, third_alpha);
+        __m128i pixels_high = _mm_unpackhi_epi16(first_green, third_alpha);
+        if (pixel_size == 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), pixels_low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16), pixels_high);
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi8(pixels_low, drop_alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 12),
+                             _mm_shuffle_epi8(pixels_high, drop_alpha));
+        }
+    }
+    return x;
+}
+
+}  // namespace
+
+ColorRowKernel GetSSE41ColorRowKernel() {
+    return &SSE41YCbCrToPixels;
+}
+
+#else
+
+ColorRowKernel GetSSE41ColorRowKernel() {
+    return nullptr;
+}
+
+#endif
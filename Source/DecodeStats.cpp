@@ -0,0 +1,132 @@
+#include "DecodeStats.h"
+#include "StatsRecorder.h"
+#include <sstream>
+
+//___DecodeStats_______________________________________________________________________________________________________________
+
+std::string DecodeStageToString(DecodeStage stage)
+{
+    switch (stage)
+    {
+        case DecodeStage::MarkerScan: return "MarkerScan";
+        case DecodeStage::HeaderParse: return "HeaderParse";
+        case DecodeStage::EntropyDecode: return "EntropyDecode";
+        case DecodeStage::IDCT: return "IDCT";
+        case DecodeStage::ColorConvert: return "ColorConvert";
+        case DecodeStage::OutputCopy: return "OutputCopy";
+    }
+    return "Unknown";
+}
+
+namespace
+{
+
+// Microseconds with the nanoseconds kept as decimals, the unit of trace timestamps.
+void WriteMicroseconds(std::ostream& output, uint64_t ns)
+{
+    output << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+}
+
+}  // namespace
+
+void DecodeStats::WriteChromeTrace(std::ostream& output) const
+{
+    size_t threads = 0;
+    for (const auto& event : events)
+    {
+        threads = std::max(threads, event.thread + 1);
+    }
+    output << "{\"traceEvents\":[";
+    for (size_t thread = 0; thread < threads; ++thread)
+    {
+        output << (thread ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread
+               << ",\"args\":{\"name\":\"" << (thread ? "Worker " + std::to_string(thread) : "Decoder") << "\"}}";
+    }
+    for (const auto& event : events)
+    {
+        output << ",\n{\"name\":\"" << DecodeStageToString(event.stage)
+               << "\",\"cat\":\"jpeg_decoder\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread << ",\"ts\":";
+        WriteMicroseconds(output, event.begin_ns);
+        output << ",\"dur\":";
+        WriteMicroseconds(output, event.duration_ns);
+        output << "}";
+    }
+    output << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+std::string DecodeStats::ChromeTrace() const
+{
+    std::ostringstream output;
+    WriteChromeTrace(output);
+    return output.str();
+}
+
+//___StatsRecorder_____________________________________________________________________________________________________________
+
+void StatsRecorder::Begin(DecodeStats* stats)
+{
+    stats_ = stats;
+    if (!stats_)
+    {
+        return;
+    }
+    // Events keep their capacity for the next decode with the same stats.
+    std::vector<TraceEvent> events = std::move(stats_->events);
+    events.clear();
+    *stats_        = {};
+    stats_->events = std::move(events);
+    threads_.assign(1, std::this_thread::get_id());
+    start_ = Clock::now();
+}
+
+void StatsRecorder::Finish()
+{
+    if (stats_)
+    {
+        stats_->total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+    }
+}
+
+void StatsRecorder::AddStage(DecodeStage stage, Clock::time_point begin, Clock::time_point end)
+{
+    auto                        ns     = [](Clock::duration duration) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        thread = std::find(threads_.begin(), threads_.end(), std::this_thread::get_id());
+    if (thread == threads_.end())
+    {
+        thread = threads_.insert(thread, std::this_thread::get_id());
+    }
+    stats_->stage_ns[static_cast<size_t>(stage)] += ns(end - begin);
+    stats_->events.push_back({stage, static_cast<size_t>(thread - threads_.begin()), ns(begin - start_), ns(end - begin)});
+}
+
+void StatsRecorder::AddCounters(const DecodeCounters& counters)
+{
+    if (!stats_)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_->mcus += counters.mcus;
+    stats_->blocks += counters.blocks;
+    stats_->eob_blocks += counters.eob_blocks;
+}
+
+void StatsRecorder::SetBytesConsumed(size_t bytes)
+{
+    if (stats_)
+    {
+        stats_->bytes_consumed = bytes;
+    }
+}
+
+void StatsRecorder::UpdateMemory(size_t coefficient_bytes, size_t pixel_bytes)
+{
+    if (stats_)
+    {
+        stats_->peak_coefficient_bytes = std::max(stats_->peak_coefficient_bytes, coefficient_bytes);
+        stats_->peak_pixel_bytes       = std::max(stats_->peak_pixel_bytes, pixel_bytes);
+    }
+}
@@ -1,60 +1,355 @@
 #include "Decoder.h"
 #include "StreamNavigator.h"
 #include "SectionDetector.h"
+#include "MappedFile.h"
 
 //___Decoder___________________________________________________________________________________________________________________
 
 class Decoder
 {
 public:
-    Decoder(std::istream& stream) : stream_(stream) {}
-    Image Decode()
+    // |data| is fresh or has only taken buffers of a previous decode.
+    Decoder(std::span<const uint8_t> stream, const DecodeOptions& options, DecoderData& data) : data_(data), stream_(stream)
+    {
+        data_.options = options;
+        data_.stats.Begin(options.stats);
+    }
+    OutputInfo ReadHeaders()
     {
-        ReadStream();
         FindSections();
-        ProcessSections();
-        data_.ProcessInverseDU();
-        data_.FillImage();
+        ProcessSections(SectionType::ImageInfo);
+        return Info();
+    }
+    // Output info from the headers before the first scan, which is all of the
+    // stream the headers only data of ReadHeaderBytes has.
+    OutputInfo ReadFrameHeaders()
+    {
+        ProcessFrameHeaders();
+        return Info();
+    }
+    void DecodeInto(const PixelView& output)
+    {
+        INVALID_ARGUMENT_IF(!output.data, "Output buffer is null.");
+        INVALID_ARGUMENT_IF(output.width != data_.out_width || output.height != data_.out_height,
+                            "Output size does not match the image.");
+        INVALID_ARGUMENT_IF(output.stride < output.width * BytesPerPixel(output.format), "Output stride is too small.");
+        data_.output = output;
+        try
+        {
+            ProcessSections(SectionType::End);
+            data_.FinishFrame();
+        } catch (...)
+        {
+            // Rows already scheduled write to the output, which the caller may
+            // free as soon as the error reaches it.
+            data_.AbandonRows();
+            throw;
+        }
+        data_.stats.Finish();
         // data_.Write();
         // data_.Info();
-        return data_.image;
+    }
+    ProbeInfo Probe()
+    {
+        ProcessFrameHeaders();
+        ProbeInfo info;
+        info.width       = data_.width;
+        info.height      = data_.height;
+        info.components  = data_.channels.size();
+        info.progressive = data_.progressive;
+        info.comment     = data_.comment;
+        for (size_t i = 0; i < info.components; ++i)
+        {
+            info.sampling[i] = {data_.channels[i].du_w, data_.channels[i].du_h};
+        }
+        return info;
+    }
+    Image Decode()
+    {
+        OutputInfo info = ReadHeaders();
+        Image      image;
+        {
+            StageTimer timer(data_.stats, DecodeStage::OutputCopy);
+            image = Image(info.width, info.height, info.format);
+        }
+        DecodeInto(image.View());
+        image.SetComment(info.comment);
+        return image;
     }
 
 private:
-    std::vector<uint8_t> stream_data_;
-    void                 FindSections()
+    OutputInfo Info() const
+    {
+        OutputInfo info;
+        info.width   = data_.out_width;
+        info.height  = data_.out_height;
+        info.format  = data_.options.pixel_format;
+        info.comment = data_.comment;
+        return info;
+    }
+    // Processes the comment, quantization tables and the frame header. Markers
+    // are indexed only up to the first scan, so the scan data is never searched.
+    void ProcessFrameHeaders()
+    {
+        SectionDetecter detecter(stream_);
+        MarkerIndex     index      = BuildMarkerIndex(stream_, data_.arena, true);
+        Section*        image_info = nullptr;
+        for (const auto& entry : index.markers)
+        {
+            auto        section = detecter.CreateSection(entry, data_.arena);
+            SectionType type    = section->Type();
+            SECTION_ERROR_IF(entry.begin == 0 && type != SectionType::Begin, "Wrong amount of Begin sections.");
+            SECTION_ERROR_IF(type == SectionType::End, "Wrong amount of ImageData sections.");
+            if (type == SectionType::ImageData)
+            {
+                break;
+            }
+            switch (type)
+            {
+                case SectionType::ImageInfo:
+                    SECTION_ERROR_IF(image_info, "Wrong amount of ImageInfo sections.");
+                    image_info = section;
+                    break;
+                case SectionType::Comment:
+                case SectionType::DQT: section->Process(data_); break;
+                default: break;
+            }
+        }
+        DATA_ERROR_IF(index.markers.empty() || index.markers.back().marker != 0xda, "Unexpected end of data.");
+        // Tables may follow the frame header, a full decode processes them first too.
+        SECTION_ERROR_IF(!image_info, "Wrong amount of ImageInfo sections.");
+        image_info->Process(data_);
+    }
+
+    size_t next_section_ = 0;
+    void   FindSections()
     {
-        SectionDetecter sec_dec(stream_data_);
+        StageTimer      timer(data_.stats, DecodeStage::MarkerScan);
+        SectionDetecter sec_dec(stream_);
         sec_dec.GetSections(data_);
         data_.ValidateSectionSet();
+        // The end of image marker is the last section once they are validated.
+        data_.stats.SetBytesConsumed(data_.sections.back()->Begin() + 2);
     }
-    void ProcessSections()
+    // Sections are sorted by type, so headers can be processed before the image data.
+    void ProcessSections(SectionType last)
     {
-        for (auto& section : data_.sections)
+        for (; next_section_ < data_.sections.size() && data_.sections[next_section_]->Type() <= last; ++next_section_)
         {
+            Section* section = data_.sections[next_section_];
+            // Scans time their headers and entropy coded data apart.
+            if (section->Type() == SectionType::ImageData)
+            {
+                section->Process(data_);
+                continue;
+            }
+            StageTimer timer(data_.stats, DecodeStage::HeaderParse);
             section->Process(data_);
         }
     }
-    void ReadStream()
+    DecoderData&             data_;
+    std::span<const uint8_t> stream_;
+};
+
+namespace {
+
+// Reads the rest of the stream. Seekable streams are read at once, others in chunks till the end.
+std::vector<uint8_t> ReadStream(std::istream& stream)
+{
+    DATA_ERROR_IF(!stream.good(), "Specified file is not valid");
+    std::vector<uint8_t> data;
+    std::streampos       begin = stream.tellg();
+    if (begin != std::streampos(-1) && stream.seekg(0, std::ios::end))
+    {
+        size_t size = stream.tellg() - begin;
+        stream.seekg(begin);
+        data.resize(size);
+        stream.read(reinterpret_cast<char*>(data.data()), size);
+        data.resize(stream.gcount());
+        return data;
+    }
+    stream.clear();
+    const size_t kChunkSize = 1 << 16;
+    while (stream)
     {
-        if (!stream_.good())
+        size_t size = data.size();
+        data.resize(size + kChunkSize);
+        stream.read(reinterpret_cast<char*>(data.data() + size), kChunkSize);
+        data.resize(size + stream.gcount());
+    }
+    return data;
+}
+
+// Reads markers of the stream up to the one starting the first scan, segments
+// are read by their lengths.
+std::vector<uint8_t> ReadHeaderBytes(std::istream& stream)
+{
+    DATA_ERROR_IF(!stream.good(), "Specified file is not valid");
+    std::vector<uint8_t> data;
+    auto                 read = [&](size_t size) {
+        size_t begin = data.size();
+        data.resize(begin + size);
+        stream.read(reinterpret_cast<char*>(data.data() + begin), size);
+        data.resize(begin + stream.gcount());
+        return data.size() == begin + size;
+    };
+    while (read(2) && data[data.size() - 2] == 0xff)
+    {
+        uint8_t marker = data.back();
+        if (marker == 0xda || marker == 0xd9)
         {
-            throw DataError("Specified file is not valid");
+            break;
+        }
+        if (marker == 0xd8)
+        {
+            continue;
+        }
+        if (!read(2))
+        {
+            break;
+        }
+        size_t length = (data[data.size() - 2] << 8) + data.back();
+        if (length < 2 || !read(length - 2))
+        {
+            break;
         }
-        stream_.seekg(0, std::ios::end);
-        size_t sz = stream_.tellg();
-        stream_.seekg(0, std::ios::beg);
-        stream_data_.resize(sz);
-        stream_.read(reinterpret_cast<char*>(stream_data_.data()), sz);
     }
-    DecoderData   data_;
-    std::istream& stream_;
-};
+    return data;
+}
+
+}  // namespace
 
 //___Final_____________________________________________________________________________________________________________________
 
-Image Decode(std::istream& input)
+Image Decode(std::span<const uint8_t> input, const DecodeOptions& options)
+{
+    DecoderData data;
+    Decoder     decoder(input, options, data);
+    return decoder.Decode();
+}
+
+Image Decode(std::istream& input, const DecodeOptions& options)
 {
-    Decoder decoder(input);
+    std::vector<uint8_t> data = ReadStream(input);
+    return Decode(data, options);
+}
+
+Image DecodeFile(const std::string& path, const DecodeOptions& options)
+{
+    MappedFile file(path);
+    return Decode(file.Data(), options);
+}
+
+Image DecodeRegion(std::span<const uint8_t> input, size_t x, size_t y, size_t width, size_t height,
+                   const DecodeOptions& options)
+{
+    DecodeOptions region_options = options;
+    region_options.region        = {x, y, width, height};
+    return Decode(input, region_options);
+}
+
+Image DecodeRegion(std::istream& input, size_t x, size_t y, size_t width, size_t height,
+                   const DecodeOptions& options)
+{
+    std::vector<uint8_t> data = ReadStream(input);
+    return DecodeRegion(data, x, y, width, height, options);
+}
+
+ProbeInfo Probe(std::span<const uint8_t> input)
+{
+    DecoderData data;
+    Decoder     decoder(input, {}, data);
+    return decoder.Probe();
+}
+
+ProbeInfo Probe(std::istream& input)
+{
+    std::vector<uint8_t> data = ReadHeaderBytes(input);
+    return Probe(data);
+}
+
+ProbeInfo ProbeFile(const std::string& path)
+{
+    MappedFile file(path);
+    return Probe(file.Data());
+}
+
+OutputInfo ReadOutputInfo(std::span<const uint8_t> input, const DecodeOptions& options)
+{
+    DecoderData data;
+    Decoder     decoder(input, options, data);
+    return decoder.ReadHeaders();
+}
+
+OutputInfo ReadOutputInfo(std::istream& input, const DecodeOptions& options)
+{
+    // Nothing is read from a stream which could not be rewound afterwards.
+    std::streampos begin = input.tellg();
+    INVALID_ARGUMENT_IF(begin == std::streampos(-1), "Stream can not be rewound, read it into memory first.");
+    std::vector<uint8_t> headers = ReadHeaderBytes(input);
+    input.clear();
+    INVALID_ARGUMENT_IF(!input.seekg(begin), "Failed to rewind the stream.");
+    DecoderData data;
+    Decoder     decoder(headers, options, data);
+    return decoder.ReadFrameHeaders();
+}
+
+void DecodeInto(std::span<const uint8_t> input, const PixelView& output, const DecodeOptions& options)
+{
+    DecoderData data;
+    Decoder     decoder(input, options, data);
+    decoder.ReadHeaders();
+    decoder.DecodeInto(output);
+}
+
+void DecodeInto(std::istream& input, const PixelView& output, const DecodeOptions& options)
+{
+    std::vector<uint8_t> data = ReadStream(input);
+    DecodeInto(data, output, options);
+}
+
+//___DecoderContext____________________________________________________________________________________________________________
+
+DecoderContext::DecoderContext() = default;
+
+DecoderContext::~DecoderContext() = default;
+
+DecoderData& DecoderContext::Fresh()
+{
+    if (!data_)
+    {
+        data_  = std::make_unique<DecoderData>();
+        spare_ = std::make_unique<DecoderData>();
+        return *data_;
+    }
+    // The spare one is constructed anew, so nothing but the buffers carries over.
+    std::destroy_at(spare_.get());
+    std::construct_at(spare_.get());
+    spare_->ReuseBuffers(*data_);
+    std::swap(data_, spare_);
+    return *data_;
+}
+
+Image DecoderContext::Decode(std::span<const uint8_t> input, const DecodeOptions& options)
+{
+    Decoder decoder(input, options, Fresh());
     return decoder.Decode();
 }
+
+OutputInfo DecoderContext::ReadOutputInfo(std::span<const uint8_t> input, const DecodeOptions& options)
+{
+    Decoder decoder(input, options, Fresh());
+    return decoder.ReadHeaders();
+}
+
+size_t DecoderContext::HeapAllocations() const
+{
+    return data_ ? data_->HeapAllocations() : 0;
+}
+
+void DecoderContext::DecodeInto(std::span<const uint8_t> input, const PixelView& output, const DecodeOptions& options)
+{
+    Decoder decoder(input, options, Fresh());
+    decoder.ReadHeaders();
+    decoder.DecodeInto(output);
+}
@@ -1,15 +1,5 @@
 #include "DecoderData.h"
-#include "FFT.h"
-
-int Clamp(int a) {
-    if (a < 0) {
-        a = 0;
-    }
-    if (a > 255) {
-        a = 255;
-    }
-    return a;
-}
+#include "IDCT.h"
 
 void DQT::Print() const {
     if (!valid) {
@@ -35,6 +25,38 @@ void Tree::Print() const {
     // tree.PrintCodes();
 }
 
+void DecoderData::ReuseBuffers(DecoderData& previous) {
+    channels = std::move(previous.channels);
+    for (auto& channel : channels) {
+        Channel fresh;
+        fresh.coefficients = std::move(channel.coefficients);
+        fresh.last_nonzero = std::move(channel.last_nonzero);
+        fresh.samples = std::move(channel.samples);
+        channel = std::move(fresh);
+    }
+    dc = std::move(previous.dc);
+    ac = std::move(previous.ac);
+    for (auto* trees : {&dc, &ac}) {
+        for (auto& tree : *trees) {
+            tree.valid = false;
+        }
+    }
+    dqts = std::move(previous.dqts);
+    for (auto& dqt : dqts) {
+        dqt.valid = false;
+    }
+    comment = std::move(previous.comment);
+    comment.clear();
+    // Sections live in the arena, so they are dropped before it is reset.
+    sections = std::move(previous.sections);
+    sections.clear();
+    arena = std::move(previous.arena);
+    arena.Reset();
+    neutral_chroma = std::move(previous.neutral_chroma);
+    upsample_buffer_ = std::move(previous.upsample_buffer_);
+    frame_buffers_ = std::move(previous.frame_buffers_);
+    buffer_allocations_ = previous.buffer_allocations_.load();
+}
 void DecoderData::ValidateSectionSet() {
     begin_cnt = 0;
     end_cnt = 0;
@@ -44,6 +66,7 @@ void DecoderData::ValidateSectionSet() {
     huffman_cnt = 0;
     image_info_cnt = 0;
     image_data_cnt = 0;
+    restart_interval_cnt = 0;
     unknown_section_cnt = 0;
 
     for (const auto& section : sections) {
@@ -69,6 +92,9 @@ void DecoderData::ValidateSectionSet() {
             case SectionType::ImageInfo:
                 ++image_info_cnt;
                 break;
+            case SectionType::RestartInterval:
+                ++restart_interval_cnt;
+                break;
             case SectionType::ImageData:
                 ++image_data_cnt;
                 break;
@@ -82,7 +108,7 @@ void DecoderData::ValidateSectionSet() {
     SECTION_ERROR_IF(begin_cnt != 1, "Wrong amount of Begin sections.");
     SECTION_ERROR_IF(end_cnt != 1, "Wrong amount of End sections.");
     SECTION_ERROR_IF(comment_cnt > 1, "Wrong amount of Comment sections.");
-    SECTION_ERROR_IF(image_data_cnt != 1, "Wrong amount of ImageData sections.");
+    SECTION_ERROR_IF(image_data_cnt == 0, "Wrong amount of ImageData sections.");
     SECTION_ERROR_IF(image_info_cnt != 1, "Wrong amount of ImageInfo sections.");
     SECTION_ERROR_IF(huffman_cnt == 0, "Wrong amount of Huffman sections.");
     SECTION_ERROR_IF(dqt_cnt == 0, "Wrong amount of Huffman sections.");
@@ -102,152 +128,349 @@ void DecoderData::ValidateImageInfo() {
         DATA_ERROR_IF(h == 0 || h > 2, "Wrong subsampling height.");
         DATA_ERROR_IF(w == 0 || w > 2, "Wrong subsampling width.");
     }
-    for (size_t i = 0; i < channels.size(); ++i) {
-        channels[i].du_per_mcu = channels[i].h * channels[i].w;
-        channels[i].h = mcu_h / channels[i].h;
-        channels[i].w = mcu_w / channels[i].w;
-    }
     mcu_x_cnt = (((width - 1) / (mcu_w * 8)) + 1);
     mcu_y_cnt = (((height - 1) / (mcu_h * 8)) + 1);
     mcu_cnt = mcu_x_cnt * mcu_y_cnt;
+    size_t scale = static_cast<size_t>(options.scale);
+    INVALID_ARGUMENT_IF(scale != 1 && scale != 2 && scale != 4 && scale != 8, "Invalid scale.");
+    out_block = 8 / scale;
+    out_width = (width + scale - 1) / scale;
+    out_height = (height + scale - 1) / scale;
+    for (auto& channel : channels) {
+        channel.du_w = channel.w;
+        channel.du_h = channel.h;
+        channel.du_per_mcu = channel.du_w * channel.du_h;
+        // Like libjpeg, subsampled channels of a scaled decode get bigger
+        // transforms where it spares their upsampling.
+        channel.block_size = out_block;
+        while (channel.block_size < 8 &&
+               (mcu_w * out_block) % (channel.du_w * channel.block_size * 2) == 0 &&
+               (mcu_h * out_block) % (channel.du_h * channel.block_size * 2) == 0) {
+            channel.block_size *= 2;
+        }
+        channel.h = mcu_h * out_block / (channel.du_h * channel.block_size);
+        channel.w = mcu_w * out_block / (channel.du_w * channel.block_size);
+        channel.blocks_per_line = mcu_x_cnt * channel.du_w;
+        channel.block_lines = mcu_y_cnt * channel.du_h;
+        channel.sample_width =
+            (width * channel.du_w * channel.block_size + mcu_w * 8 - 1) / (mcu_w * 8);
+        channel.sample_height =
+            (height * channel.du_h * channel.block_size + mcu_h * 8 - 1) / (mcu_h * 8);
+    }
+    SetRegion();
 }
-void DecoderData::PreValidateImageData() {
-    for (size_t i = 0; i < channels.size(); ++i) {
-        auto dc_id = channels[i].dc_id;
-        auto ac_id = channels[i].ac_id;
-        DATA_ERROR_IF(!channels[i].valid_ac_dc, "Invalid ACDC.");
-        DATA_ERROR_IF(dc_id >= dc.size() || !dc[dc_id].valid, "Wrong DC id.");
-        DATA_ERROR_IF(ac_id >= ac.size() || !ac[ac_id].valid, "Wrong AC id.");
+void DecoderData::SetRegion() {
+    Region region = options.region;
+    if (region.Empty()) {
+        region = {0, 0, out_width, out_height};
+    }
+    INVALID_ARGUMENT_IF(region.x + region.width > out_width || region.y + region.height > out_height,
+                        "Region is outside of the image.");
+    crop_x = region.x;
+    crop_y = region.y;
+    out_width = region.width;
+    out_height = region.height;
+
+    // Fancy upsampling reads a neighbour sample on each side, the margin of 2
+    // keeps windows of the horizontal filter wider than 2 samples too.
+    const size_t kMargin = 2;
+    crop_mcus = {mcu_x_cnt, 0, mcu_y_cnt, 0};
+    for (auto& channel : channels) {
+        size_t left = region.x / channel.w;
+        size_t right = (region.x + region.width - 1) / channel.w;
+        channel.window_begin = left > kMargin ? left - kMargin : 0;
+        channel.window_end = std::min(right + kMargin + 1, channel.sample_width);
+        size_t top = region.y / channel.h;
+        size_t bottom = (region.y + region.height - 1) / channel.h;
+        top = top > kMargin ? top - kMargin : 0;
+        bottom = std::min(bottom + kMargin, channel.sample_height - 1);
+
+        size_t mcu_width = channel.du_w * channel.block_size;
+        size_t mcu_height = channel.du_h * channel.block_size;
+        crop_mcus.x_begin = std::min(crop_mcus.x_begin, channel.window_begin / mcu_width);
+        crop_mcus.x_end = std::max(crop_mcus.x_end, (channel.window_end - 1) / mcu_width + 1);
+        crop_mcus.y_begin = std::min(crop_mcus.y_begin, top / mcu_height);
+        crop_mcus.y_end = std::max(crop_mcus.y_end, bottom / mcu_height + 1);
     }
 }
+namespace {
 
-void ProcessDU(std::vector<int64_t>& du, const std::vector<int64_t>& dqt, NewFFT& calculator) {
-    std::vector<double> source(64);
-    std::vector<double> res(64);
-    for (size_t i = 0; i < dqt.size(); ++i) {
-        source[i] = du[i] * dqt[i];
+// Layout of an interleaved scan of |ids|, a frame of three channels has one of
+// the specialised layouts unless its chroma is subsampled at an odd ratio.
+MCULayout InterleavedLayout(const std::vector<Channel>& channels, std::span<const size_t> ids) {
+    if (ids.size() != 3) {
+        return MCULayout::Generic;
     }
-    calculator.Inverse(source, res);
-    for (size_t i = 0; i < dqt.size(); ++i) {
-        du[i] = Clamp(res[i] + 128);
+    for (size_t i = 1; i < ids.size(); ++i) {
+        if (channels[ids[i]].du_per_mcu != 1) {
+            return MCULayout::Generic;
+        }
+    }
+    const auto& first = channels[ids[0]];
+    if (first.du_w == 1) {
+        return first.du_h == 1 ? MCULayout::YCbCr444 : MCULayout::YCbCr440;
+    }
+    return first.du_h == 1 ? MCULayout::YCbCr422 : MCULayout::YCbCr420;
+}
+
+}  // namespace
+
+void DecoderData::BeginScan(const ScanInfo& scan_info) {
+    scan = scan_info;
+    // DC refinement needs no tables, AC scans need no DC ones.
+    bool needs_dc = scan.ss == 0 && scan.ah == 0;
+    bool needs_ac = scan.se != 0;
+    for (auto id : scan.channels) {
+        auto dc_id = channels[id].dc_id;
+        auto ac_id = channels[id].ac_id;
+        DATA_ERROR_IF(!channels[id].valid_ac_dc, "Invalid ACDC.");
+        DATA_ERROR_IF(needs_dc && (dc_id >= dc.size() || !dc[dc_id].valid), "Wrong DC id.");
+        DATA_ERROR_IF(needs_ac && (ac_id >= ac.size() || !ac[ac_id].valid), "Wrong AC id.");
+    }
+
+    if (scan.channels.size() == 1) {
+        // Blocks covering the channel at the full resolution.
+        const auto& channel = channels[scan.channels[0]];
+        size_t channel_width = (width * channel.du_w + mcu_w - 1) / mcu_w;
+        size_t channel_height = (height * channel.du_h + mcu_h - 1) / mcu_h;
+        scan.mcu_x_cnt = (channel_width + 7) / 8;
+        scan.mcu_cnt = scan.mcu_x_cnt * ((channel_height + 7) / 8);
+        scan.needed = {crop_mcus.x_begin * channel.du_w,
+                       std::min(crop_mcus.x_end * channel.du_w, scan.mcu_x_cnt),
+                       crop_mcus.y_begin * channel.du_h,
+                       std::min(crop_mcus.y_end * channel.du_h, scan.mcu_cnt / scan.mcu_x_cnt)};
+        scan.layout = MCULayout::Single;
+    } else {
+        scan.layout = InterleavedLayout(channels, scan.channels);
+        scan.mcu_x_cnt = mcu_x_cnt;
+        scan.mcu_cnt = mcu_cnt;
+        scan.needed = crop_mcus;
+    }
+
+    if (scan_cnt++ == 0) {
+        // Only a single baseline scan of all channels can be streamed row by row.
+        full_frame = progressive || scan.channels.size() != channels.size() ||
+                     (options.parallel_restart_intervals && restart_interval != 0);
+        AllocateBuffers();
+    } else {
+        DATA_ERROR_IF(!full_frame, "Wrong amount of ImageData sections.");
+    }
+}
+
+void DecoderData::FinishFrame() {
+    if (full_frame) {
+        ProcessFrame();
+    } else if (row_tasks_) {
+        row_tasks_->Wait();
     }
 }
 
-void DecoderData::PreProcessDC() {
+void DecoderData::AllocateBuffers() {
+    idct = GetIDCTBackend(options.idct);
+    INVALID_ARGUMENT_IF(!idct, "IDCT backend is not available.");
+    color_kernel = GetColorRowKernel(options.idct);
     for (auto& channel : channels) {
-        auto& du = channel.du;
-        for (size_t i = 1; i < du.size(); ++i) {
-            du[i][0] += du[i - 1][0];
+        // Streamed rows need the row being decoded and the one being transformed,
+        // samples of the converted row and of its neighbours.
+        channel.coefficient_lines = full_frame ? channel.block_lines : 2 * channel.du_h;
+        channel.sample_rows = full_frame ? mcu_y_cnt : 3;
+        buffer_allocations_ += channel.coefficients.Resize(channel.coefficient_lines * channel.blocks_per_line * 64);
+        buffer_allocations_ += channel.last_nonzero.Resize(channel.coefficient_lines * channel.blocks_per_line);
+        buffer_allocations_ += channel.samples.Resize(channel.SamplesStride() * channel.du_h * channel.block_size *
+                                                      channel.sample_rows);
+    }
+    if (full_frame) {
+        // Bands and channels missing from the scans stay zero.
+        for (auto& channel : channels) {
+            std::memset(channel.coefficients.Data(), 0, channel.coefficients.Size() * sizeof(int16_t));
+            std::memset(channel.last_nonzero.Data(), 0, channel.last_nonzero.Size());
         }
     }
+    buffer_allocations_ += upsample_buffer_.Resize(mcu_x_cnt * mcu_w * 8);
+    if (channels.size() == 2) {
+        buffer_allocations_ += neutral_chroma.Resize(mcu_x_cnt * mcu_w * 8);
+        std::memset(neutral_chroma.Data(), 128, neutral_chroma.Size());
+    }
+    RecordMemory();
 }
-void DecoderData::ProcessInverseDU() {
-    PreProcessDC();
-    std::vector<double>* in = new std::vector<double>(64);
-    std::vector<double>* out = new std::vector<double>(64);
-    NewFFT calculator(8, in, out);
-    for (auto& channel : channels) {
-        for (auto& unit : channel.du) {
-            ProcessDU(unit, dqts[channel.dqt_id].table, calculator);
+
+void DecoderData::RecordMemory() {
+    if (!stats.Enabled()) {
+        return;
+    }
+    size_t coefficient_bytes = 0;
+    size_t pixel_bytes = neutral_chroma.Size();
+    for (const auto& channel : channels) {
+        coefficient_bytes += channel.coefficients.Size() * sizeof(int16_t) + channel.last_nonzero.Size();
+        pixel_bytes += channel.samples.Size();
+    }
+    // Streamed rows share a single upsampling buffer, full frames have one per task.
+    if (full_frame) {
+        for (const auto& buffer : frame_buffers_) {
+            for (const auto& row : buffer.rows) {
+                pixel_bytes += row.Size();
+            }
         }
     }
-    delete in;
-    delete out;
+    for (const auto& row : upsample_buffer_.rows) {
+        pixel_bytes += row.Size();
+    }
+    stats.UpdateMemory(coefficient_bytes, pixel_bytes);
 }
 
-YCC DecoderData::GetYCCFromXY(size_t x, size_t y) {
-    YCC res;
-    size_t mcu_id = (y / (mcu_h * 8)) * mcu_x_cnt + x / (mcu_w * 8);
-    // std::cout << "X: " << x << " Y: " << y << " MCU_ID: " << mcu_id << std::endl;
-    x %= (mcu_w * 8);
-    y %= (mcu_h * 8);
-    // std::cout << x << " " << y << std::endl;
-    if (!channels.empty()) {
-        int32_t c_id = 0;
-        int32_t du_cnt = channels[c_id].du_per_mcu;
-        int32_t c_mcu_w = channels[c_id].w;
-        int32_t c_mcu_h = channels[c_id].h;
-        int32_t block_x = x / (c_mcu_w * 8);
-        int32_t block_y = y / (c_mcu_h * 8);
-        int32_t block_r_id = block_y * (mcu_w / c_mcu_w) + block_x;
-        int32_t r_x = (x % (c_mcu_w * 8)) / c_mcu_w;
-        int32_t r_y = (y % (c_mcu_h * 8)) / c_mcu_h;
-        int32_t r_id = r_y * 8 + r_x;
-        int32_t block_id = mcu_id * du_cnt + block_r_id;
-        // std::cout << "BlockId: " << block_id << " RID: " << r_id << std::endl;
-        res.y = channels[c_id].du[block_id][r_id];
-    }
-    if (channels.size() > 1) {
-        int32_t c_id = 1;
-        int32_t du_cnt = channels[c_id].du_per_mcu;
-        int32_t c_mcu_w = channels[c_id].w;
-        int32_t c_mcu_h = channels[c_id].h;
-        int32_t block_x = x / (c_mcu_w * 8);
-        int32_t block_y = y / (c_mcu_h * 8);
-        int32_t block_r_id = block_y * (mcu_w / c_mcu_w) + block_x;
-        int32_t r_x = (x % (c_mcu_w * 8)) / c_mcu_w;
-        int32_t r_y = (y % (c_mcu_h * 8)) / c_mcu_h;
-        int32_t r_id = r_y * 8 + r_x;
-        int32_t block_id = mcu_id * du_cnt + block_r_id;
-        // std::cout << "BlockId: " << block_id << " RID: " << r_id << std::endl;
-        res.cb = channels[c_id].du[block_id][r_id];
-    }
-    if (channels.size() > 2) {
-        int32_t c_id = 2;
-        int32_t du_cnt = channels[c_id].du_per_mcu;
-        int32_t c_mcu_w = channels[c_id].w;
-        int32_t c_mcu_h = channels[c_id].h;
-        int32_t block_x = x / (c_mcu_w * 8);
-        int32_t block_y = y / (c_mcu_h * 8);
-        int32_t block_r_id = block_y * (mcu_w / c_mcu_w) + block_x;
-        int32_t r_x = (x % (c_mcu_w * 8)) / c_mcu_w;
-        int32_t r_y = (y % (c_mcu_h * 8)) / c_mcu_h;
-        int32_t block_id = mcu_id * du_cnt + block_r_id;
-        // std::cout << "BlockId: " << block_id << " RID: " << r_id << std::endl;
-        res.cr = channels[c_id].du[block_id][r_y * 8 + r_x];
-    }
-    // std::cout << std::endl;
-    // std::cout << res.y << " " << res.cb << " " << res.cr << std::endl;
-    return res;
+void DecoderData::ScheduleMCURow(size_t row) {
+    if (!row_tasks_) {
+        row_tasks_.emplace(Pool());
+    }
+    // Rows share the samples ring, so they are processed one after another.
+    row_tasks_->Wait();
+    row_tasks_->Run([this, row]() { ProcessMCURow(row); });
+    scheduled_rows_ = row + 1;
 }
-RGB DecoderData::YCCToRGB(YCC ycc) {
-    RGB res;
-    double y = static_cast<double>(ycc.y);
-    double cb = static_cast<double>(ycc.cb - 128);
-    double cr = static_cast<double>(ycc.cr - 128);
-    res.r = Clamp(std::round(y + 1.402000 * cr));
-    res.g = Clamp(std::round(y - 0.344136 * cb - 0.714136 * cr));
-    res.b = Clamp(std::round(y + 1.772000 * cb));
 
-    return res;
+void DecoderData::AbandonRows() {
+    row_tasks_.reset();
+}
+
+size_t DecoderData::FinishedRows() {
+    if (row_tasks_) {
+        row_tasks_->Wait();
+    }
+    // Conversion lags a row behind, except for the last one.
+    if (scheduled_rows_ >= crop_mcus.y_end) {
+        return out_height;
+    }
+    size_t converted = scheduled_rows_ ? (scheduled_rows_ - 1) * mcu_h * out_block : 0;
+    return std::min(converted > crop_y ? converted - crop_y : 0, out_height);
+}
+
+void DecoderData::ProcessFrame() {
+    ThreadPool& pool = Pool();
+    size_t first = crop_mcus.y_begin;
+    size_t rows = crop_mcus.y_end - first;
+    pool.ParallelFor(rows, [this, first](size_t row) { TransformMCURow(first + row); });
+    // Rows are converted in a band per task, which keeps its upsampling buffer.
+    size_t tasks = std::min(rows, pool.Workers() + 1);
+    if (frame_buffers_.size() < tasks) {
+        buffer_allocations_ += frame_buffers_.capacity() < tasks;
+        frame_buffers_.resize(tasks);
+    }
+    pool.ParallelFor(tasks, [this, tasks](size_t task) {
+        size_t first = crop_mcus.y_begin;
+        size_t rows = crop_mcus.y_end - first;
+        UpsampleBuffer& buffer = frame_buffers_[task];
+        buffer_allocations_ += buffer.Resize(mcu_x_cnt * mcu_w * 8);
+        for (size_t row = rows * task / tasks; row < rows * (task + 1) / tasks; ++row) {
+            ConvertMCURow(first + row, buffer);
+        }
+    });
+    RecordMemory();
 }
 
-void UpdatePixel(DecoderData& data, size_t y_begin, size_t y_end) {
+void DecoderData::ProcessMCURow(size_t row) {
+    if (row < crop_mcus.y_begin) {
+        return;
+    }
+    TransformMCURow(row);
+    if (row > crop_mcus.y_begin) {
+        ConvertMCURow(row - 1, upsample_buffer_);
+    }
+    if (row + 1 == crop_mcus.y_end) {
+        ConvertMCURow(row, upsample_buffer_);
+    }
+}
+
+void DecoderData::TransformMCURow(size_t row) {
+    StageTimer timer(stats, DecodeStage::IDCT);
+    for (auto& channel : channels) {
+        const auto& quant = dqts[channel.dqt_id].table;
+        size_t stride = channel.SamplesStride();
+        size_t size = channel.block_size;
+        for (size_t line = row * channel.du_h; line < (row + 1) * channel.du_h; ++line) {
+            uint8_t* samples = channel.SampleRow(line * size);
+            for (size_t x = crop_mcus.x_begin * channel.du_w; x < crop_mcus.x_end * channel.du_w; ++x) {
+                // Most blocks of photos end early in zigzag order, DC only ones
+                // are a single sample.
+                uint8_t last = channel.LastNonzero(x, line);
+                const int16_t* block = channel.Block(x, line);
+                if (size == 8) {
+                    if (last == 0) {
+                        idct->InverseDC(block, quant.data(), samples + x * 8, stride);
+                    } else if (last < kLowFrequencyEnd) {
+                        idct->InverseLow(block, quant.data(), samples + x * 8, stride);
+                    } else {
+                        idct->Inverse(block, quant.data(), samples + x * 8, stride);
+                    }
+                } else if (last == 0) {
+                    InverseReducedDC(block, quant.data(), samples + x * size, stride, size);
+                } else {
+                    InverseReduced(block, quant.data(), samples + x * size, stride, size);
+                }
+            }
+        }
+    }
+}
+
+void DecoderData::ConvertMCURow(size_t row, UpsampleBuffer& buffer) {
+    StageTimer timer(stats, DecodeStage::ColorConvert);
+    bool gray = channels.size() == 1 || output.format == PixelFormat::Gray8;
+    // Rows and columns of the frame are offset by the region.
+    size_t y_begin = std::max(crop_y, row * mcu_h * out_block);
+    size_t y_end = std::min(crop_y + out_height, (row + 1) * mcu_h * out_block);
     for (size_t y = y_begin; y < y_end; ++y) {
-        for (size_t x = 0; x < data.width; ++x) {
-            auto p = data.YCCToRGB(data.GetYCCFromXY(x, y));
-            data.image.SetPixel(y, x, p);
+        uint8_t* pixels = output.Row(y - crop_y);
+        const uint8_t* luma = UpsampledRow(0, y, buffer) + crop_x;
+        if (gray) {
+            GrayToPixels(luma, pixels, out_width, output.format);
+            continue;
         }
+        const uint8_t* blue = UpsampledRow(1, y, buffer) + crop_x;
+        const uint8_t* red =
+            channels.size() > 2 ? UpsampledRow(2, y, buffer) + crop_x : neutral_chroma.Data();
+        YCbCrToPixels(color_kernel, luma, blue, red, pixels, out_width, output.format);
     }
 }
 
-void DecoderData::FillImage() {
-    // std::cout << channels[0].du.size() << " " << channels[1].du.size() << " "
-    //           << channels[2].du.size() << std::endl;
-    std::vector<std::thread> threads;
-    size_t num_threads = std::thread::hardware_concurrency();
-    std::vector<size_t> boundaries;
-    size_t step = height / num_threads;
-    for (size_t i = 0; i < num_threads; ++i) {
-        boundaries.push_back(step * i);
-    }
-    boundaries.push_back(height);
-    for (size_t i = 0; i < num_threads; ++i) {
-        threads.emplace_back(UpdatePixel, std::ref(*this), boundaries[i], boundaries[i + 1]);
-    }
-    for (auto& t : threads) {
-        t.join();
+const uint8_t* DecoderData::UpsampledRow(size_t id, size_t y, UpsampleBuffer& buffer) {
+    Channel& channel = channels[id];
+    size_t line = y / channel.h;
+    if (channel.w == 1 && channel.h == 1) {
+        return channel.SampleRow(line);
+    }
+    // Samples of the region's window and their upsampled pixels.
+    size_t begin = channel.window_begin;
+    size_t width = channel.window_end - begin;
+    uint8_t* result = buffer.rows[id].Data() + begin * channel.w;
+    // libjpeg replicates samples of rows too narrow for the horizontal filter
+    // and of 1/8 scaled decodes.
+    bool fancy = options.upsampling == UpsamplingMode::Fancy && out_block > 1 &&
+                 (channel.w == 1 || channel.sample_width > 2);
+    if (!fancy) {
+        if (channel.w == 1) {
+            return channel.SampleRow(line);
+        }
+        // Both pixel rows of a vertically subsampled line share the result.
+        if (buffer.lines[id] != line) {
+            UpsampleH2(channel.SampleRow(line) + begin, result, width);
+            buffer.lines[id] = line;
+        }
+        return buffer.rows[id].Data();
+    }
+    if (channel.h == 1) {
+        UpsampleH2Fancy(channel.SampleRow(line) + begin, result, width);
+        return buffer.rows[id].Data();
+    }
+    // Lines outside of the channel replicate its edges.
+    bool lower = y % 2;
+    size_t farthest = lower ? std::min(line + 1, channel.sample_height - 1) : (line ? line - 1 : 0);
+    if (channel.w == 2) {
+        UpsampleH2V2Fancy(channel.SampleRow(line) + begin, channel.SampleRow(farthest) + begin,
+                          result, width);
+    } else {
+        UpsampleV2Fancy(channel.SampleRow(line) + begin, channel.SampleRow(farthest) + begin,
+                        result, width, lower);
     }
+    return buffer.rows[id].Data();
 }
 
 void DecoderData::Info() {
@@ -277,6 +500,7 @@ void DecoderData::Info() {
     std::cout << "  DQT: " << dqt_cnt << std::endl;
     std::cout << "  Huffman: " << huffman_cnt << std::endl;
     std::cout << "  ImageData: " << image_data_cnt << std::endl;
+    std::cout << "  RestartInterval: " << restart_interval_cnt << std::endl;
     std::cout << "  ImageInfo: " << image_info_cnt << std::endl;
     std::cout << "PICTURE: " << std::endl;
     std::cout << "  Size: " << width << "x" << height << std::endl;
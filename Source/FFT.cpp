@@ -82,16 +82,15 @@ void NewFFT::Inverse(const std::vector<double>& input, std::vector<double>& outp
                 fraction *= sqrt(2);
             }
 
-            in_->at(id) = input[id] * fraction;
+            (*in_)[id] = input[id] * fraction;
         }
     }
 
     fftw_execute(p_);
-    fftw_cleanup();
 
     for (size_t i = 0; i < width_ * width_; ++i)
     {
-        output[i] = out_->at(i) / 16;
+        output[i] = (*out_)[i] / 16;
     }
 }
 NewFFT::NewFFT(size_t width, std::vector<double>* in, std::vector<double>* out) : width_(width)
@@ -1,130 +1,96 @@
 #include "Huffman.h"
 #include "Exceptions.h"
 
-class HuffmanTree::Impl {
-private:
-    struct Node {
-        std::shared_ptr<Node> left = nullptr;
-        std::shared_ptr<Node> right = nullptr;
-        int64_t value = -1;
+void HuffmanTree::Build(std::span<const uint8_t> code_lengths,
+                        std::span<const uint8_t> values) {
+    INVALID_ARGUMENT_IF(code_lengths.size() > 16, "Max len of huffman is 16.");
+    INVALID_ARGUMENT_IF(values.size() > values_.size(), "To many values.");
 
-        bool IsTerminal() const {
-            return value != -1;
-        }
-    };
-
-    size_t size_ = 0;
-    std::shared_ptr<Node> root_;
-    std::shared_ptr<Node> current_;
-    std::vector<size_t> traverse_;
-    std::vector<std::pair<size_t, std::vector<bool>>> codes_;
+    built_ = false;
+    lookup_.fill(0);
+    fast_.fill(0);
+    max_code_.fill(-1);
+    value_offset_.fill(0);
+    move_code_ = 0;
+    move_length_ = 0;
 
-    bool AddCode(std::shared_ptr<Node> current, size_t len, size_t value) {
-        if (len == 0) {
-            if (!current->IsTerminal()) {
-                current->value = value;
-                return true;
+    size_t current_value = 0;
+    int32_t code = 0;
+    for (size_t i = 0; i < code_lengths.size(); ++i) {
+        size_t length = i + 1;
+        value_offset_[length] = static_cast<int32_t>(current_value) - code;
+        for (size_t k = 0; k < code_lengths[i]; ++k, ++code) {
+            INVALID_ARGUMENT_IF(current_value >= values.size(), "To many codes in code_lengts.");
+            INVALID_ARGUMENT_IF(code >= (1 << length), "Impossible to add key.");
+            uint8_t value = values[current_value];
+            values_[current_value++] = value;
+            max_code_[length] = code;
+            if (length > kLookupBits) {
+                continue;
             }
-            return false;
-        }
-        if (!current->left) {
-            current->left = std::make_shared<Node>();
-        }
-        codes_.back().second.push_back(false);
-        if (!current->left->IsTerminal() && AddCode(current->left, len - 1, value)) {
-            return true;
-        }
-        codes_.back().second.pop_back();
-        if (!current->right) {
-            current->right = std::make_shared<Node>();
-        }
-        codes_.back().second.push_back(true);
-        if (!current->right->IsTerminal() && AddCode(current->right, len - 1, value)) {
-            return true;
-        }
-        codes_.back().second.pop_back();
-        return false;
-    }
-
-public:
-    Impl(const std::vector<uint8_t> &code_lengths, const std::vector<uint8_t> &values) {
-        root_ = std::make_shared<Node>();
-        current_ = root_;
 
-        size_t current_code = 0;
-        INVALID_ARGUMENT_IF(code_lengths.size() > 16, "Max len of huffman is 16.");
-        for (size_t i = 0; i < code_lengths.size(); ++i) {
-            for (size_t k = 0; k < code_lengths[i]; ++k) {
-                INVALID_ARGUMENT_IF(current_code >= values.size(), "To many codes in code_lengts.");
-                codes_.push_back({values[current_code], {}});
-                INVALID_ARGUMENT_IF(!AddCode(root_, i + 1, values[current_code++]),
-                                    "Impossible to add key.");
+            size_t shift = kLookupBits - length;
+            size_t first = static_cast<size_t>(code) << shift;
+            size_t last = first + (1ull << shift);
+            size_t magnitude = value & 0x0f;
+            for (size_t index = first; index < last; ++index) {
+                lookup_[index] = (length << 8) | value;
+                if (length + magnitude > kLookupBits || magnitude > 7) {
+                    continue;
+                }
+                int coefficient = 0;
+                if (magnitude) {
+                    coefficient = (index >> (shift - magnitude)) & ((1 << magnitude) - 1);
+                    if (coefficient < (1 << (magnitude - 1))) {
+                        coefficient -= (1 << magnitude) - 1;
+                    }
+                }
+                fast_[index] = static_cast<int16_t>(coefficient * 256 + (value & 0xf0) +
+                                                    length + magnitude);
             }
         }
-        INVALID_ARGUMENT_IF(current_code != values.size(), "To many values.");
-
-        size_ = current_code;
-    }
-    bool Move(bool bit, int &value) {
-        INVALID_ARGUMENT_IF(!current_, "Tree is not builded yet.");
-        if (!bit) {
-            INVALID_ARGUMENT_IF(!current_->left, "Cannot go left in tree.");
-            current_ = current_->left;
-        } else {
-            INVALID_ARGUMENT_IF(!current_->right, "Cannot go right in tree.");
-            current_ = current_->right;
-        }
-        if (current_->IsTerminal()) {
-            value = current_->value;
-            current_ = root_;
-            return true;
-        }
-        return false;
-    }
-    size_t Size() const {
-        return size_;
+        code <<= 1;
     }
+    INVALID_ARGUMENT_IF(current_value != values.size(), "To many values.");
+    built_ = true;
+}
 
-    void PrintCodes() const {
-        for (const auto &[value, code] : codes_) {
-            std::cout << std::setfill('0') << std::setw(2) << std::hex << value << ": ";
-            for (auto v : code) {
-                std::cout << (v ? '1' : '0');
-            }
-            std::cout << std::endl;
+size_t HuffmanTree::DecodeLong(uint32_t bits, int &value) const {
+    INVALID_ARGUMENT_IF(!built_, "Tree is not builded yet.");
+    for (size_t length = kLookupBits + 1; length <= 16; ++length) {
+        int32_t code = bits >> (16 - length);
+        if (code <= max_code_[length]) {
+            value = values_[code + value_offset_[length]];
+            return length;
         }
-        std::cout << std::dec;
     }
-};
-
-void HuffmanTree::Build(const std::vector<uint8_t> &code_lengths,
-                        const std::vector<uint8_t> &values) {
-    impl_ = std::make_unique<Impl>(code_lengths, values);
+    INVALID_ARGUMENT_IF(true, "Invalid huffman code.");
 }
 
 // Moves the state of the huffman tree by |bit|. If the node is terminated,
 // returns true and overwrites |value|. If it is intermediate, returns false
 // and value is unmodified.
 bool HuffmanTree::Move(bool bit, int &value) {
-    INVALID_ARGUMENT_IF(!impl_, "Tree is not builded yet.");
-    return impl_->Move(bit, value);
+    INVALID_ARGUMENT_IF(!built_, "Tree is not builded yet.");
+    move_code_ = (move_code_ << 1) | bit;
+    ++move_length_;
+    if (move_code_ <= max_code_[move_length_]) {
+        value = values_[move_code_ + value_offset_[move_length_]];
+        move_code_ = 0;
+        move_length_ = 0;
+        return true;
+    }
+    if (move_length_ == 16) {
+        move_code_ = 0;
+        move_length_ = 0;
+        INVALID_ARGUMENT_IF(true, "Cannot go right in tree.");
+    }
+    return false;
 }
-// size_t HuffmanTree::Size() const {
-//     INVALID_ARGUMENT_IF(!impl_, "Tree is not builded yet.");
-//     return impl_->Size();
-// }
-// void HuffmanTree::PrintCodes() const {
-//     INVALID_ARGUMENT_IF(!impl_, "Tree is not builded yet.");
-//     return impl_->PrintCodes();
-// }
 HuffmanTree::HuffmanTree() {
+    max_code_.fill(-1);
 }
-HuffmanTree::HuffmanTree(HuffmanTree &&other) {
-    impl_ = std::move(other.impl_);
-}
-HuffmanTree &HuffmanTree::operator=(HuffmanTree &&other) {
-    impl_ = std::move(other.impl_);
-    return *this;
-}
+HuffmanTree::HuffmanTree(HuffmanTree &&other) = default;
+HuffmanTree &HuffmanTree::operator=(HuffmanTree &&other) = default;
 HuffmanTree::~HuffmanTree() {
 }
@@ -0,0 +1,206 @@
+#include "IDCT.h"
+#include "IDCTKernel.h"
+#include "Exceptions.h"
+
+#ifdef JPEG_DECODER_HAS_FFTW
+#include "FFT.h"
+#include <mutex>
+#endif
+
+namespace {
+
+// With |Low| only columns and rows 0-3 of the coefficients are read, the
+// others are known to be zero.
+template <bool Low>
+void InverseScalar(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                   size_t stride) {
+    constexpr size_t kInputs = Low ? 4 : 8;
+    // Like libjpeg, the workspace keeps the first pass results truncated to int.
+    int32_t workspace[64];
+    int64_t in[8];
+    int64_t out[8];
+    for (size_t x = 0; x < kInputs; ++x) {
+        for (size_t y = 0; y < kInputs; ++y) {
+            in[y] = static_cast<int64_t>(coefficients[y * 8 + x]) * quant[y * 8 + x];
+        }
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass1Shift>(in, out);
+        } else {
+            idct::Inverse1D<idct::kPass1Shift>(in, out);
+        }
+        for (size_t y = 0; y < 8; ++y) {
+            workspace[y * 8 + x] = static_cast<int32_t>(out[y]);
+        }
+    }
+    for (size_t y = 0; y < 8; ++y) {
+        std::copy_n(workspace + y * 8, 8, in);
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass2Shift>(in, out);
+        } else {
+            idct::Inverse1D<idct::kPass2Shift>(in, out);
+        }
+        for (size_t x = 0; x < 8; ++x) {
+            output[y * stride + x] = idct::RangeLimit(out[x]);
+        }
+    }
+}
+
+class ScalarIDCT : public IDCTBackend {
+public:
+    virtual IDCTBackendType Type() const override {
+        return IDCTBackendType::Scalar;
+    }
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const override {
+        InverseScalar<false>(coefficients, quant, output, stride);
+    }
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const override {
+        InverseScalar<true>(coefficients, quant, output, stride);
+    }
+};
+
+#ifdef JPEG_DECODER_HAS_FFTW
+// Floating point reference, kept for accuracy comparisons.
+class FFTWIDCT : public IDCTBackend {
+private:
+    mutable std::mutex mutex_;
+    mutable std::vector<double> in_;
+    mutable std::vector<double> out_;
+    mutable std::vector<double> source_;
+    mutable std::vector<double> result_;
+    mutable NewFFT calculator_;
+
+public:
+    FFTWIDCT() : in_(64), out_(64), source_(64), result_(64), calculator_(8, &in_, &out_) {
+    }
+    virtual IDCTBackendType Type() const override {
+        return IDCTBackendType::FFTW;
+    }
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const override {
+        std::lock_guard lock(mutex_);
+        for (size_t i = 0; i < 64; ++i) {
+            source_[i] = static_cast<double>(coefficients[i]) * quant[i];
+        }
+        calculator_.Inverse(source_, result_);
+        for (size_t y = 0; y < 8; ++y) {
+            for (size_t x = 0; x < 8; ++x) {
+                int value = result_[y * 8 + x] + 128;
+                output[y * stride + x] = std::clamp(value, 0, 255);
+            }
+        }
+    }
+    // Rounding of the floating point transform differs from the fixed point
+    // shortcuts, so every block takes the full transform.
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const override {
+        Inverse(coefficients, quant, output, stride);
+    }
+    virtual void InverseDC(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                           size_t stride) const override {
+        Inverse(coefficients, quant, output, stride);
+    }
+};
+#endif
+
+}  // namespace
+
+void IDCTBackend::InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                             size_t stride) const {
+    Inverse(coefficients, quant, output, stride);
+}
+
+void IDCTBackend::InverseDC(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const {
+    InverseReducedDC(coefficients, quant, output, stride, 8);
+}
+
+void InverseReducedDC(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                      size_t stride, size_t size) {
+    uint8_t sample = idct::RangeLimit(idct::InverseDC(static_cast<int32_t>(coefficients[0]) * quant[0]));
+    for (size_t y = 0; y < size; ++y) {
+        std::memset(output + y * stride, sample, size);
+    }
+}
+
+bool CpuSupports(IDCTBackendType type) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    switch (type) {
+        case IDCTBackendType::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case IDCTBackendType::AVX2:
+            return __builtin_cpu_supports("avx2");
+        default:
+            return true;
+    }
+#else
+    (void)type;
+    return true;
+#endif
+}
+
+bool IsBitExact(IDCTBackendType type) {
+    return type != IDCTBackendType::FFTW;
+}
+
+std::string IDCTBackendTypeToString(IDCTBackendType type) {
+    switch (type) {
+        case IDCTBackendType::Auto:
+            return "Auto";
+        case IDCTBackendType::Scalar:
+            return "Scalar";
+        case IDCTBackendType::SSE41:
+            return "SSE4.1";
+        case IDCTBackendType::AVX2:
+            return "AVX2";
+        case IDCTBackendType::NEON:
+            return "NEON";
+        case IDCTBackendType::FFTW:
+            return "FFTW";
+    }
+    return "Unknown";
+}
+
+const IDCTBackend* GetIDCTBackend(IDCTBackendType type) {
+    static const ScalarIDCT kScalar;
+    switch (type) {
+        case IDCTBackendType::Auto:
+            for (auto candidate :
+                 {IDCTBackendType::AVX2, IDCTBackendType::SSE41, IDCTBackendType::NEON}) {
+                if (auto backend = GetIDCTBackend(candidate)) {
+                    return backend;
+                }
+            }
+            return &kScalar;
+        case IDCTBackendType::Scalar:
+            return &kScalar;
+        case IDCTBackendType::SSE41:
+            return CpuSupports(type) ? GetSSE41IDCTBackend() : nullptr;
+        case IDCTBackendType::AVX2:
+            return CpuSupports(type) ? GetAVX2IDCTBackend() : nullptr;
+        case IDCTBackendType::NEON:
+            return GetNEONIDCTBackend();
+        case IDCTBackendType::FFTW:
+#ifdef JPEG_DECODER_HAS_FFTW
+        {
+            static const FFTWIDCT kFFTW;
+            return &kFFTW;
+        }
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+std::vector<IDCTBackendType> AvailableIDCTBackends() {
+    std::vector<IDCTBackendType> backends;
+    for (auto type : {IDCTBackendType::Scalar, IDCTBackendType::SSE41, IDCTBackendType::AVX2,
+                      IDCTBackendType::NEON, IDCTBackendType::FFTW}) {
+        if (GetIDCTBackend(type)) {
+            backends.push_back(type);
+        }
+    }
+    return backends;
+}
@@ -0,0 +1,131 @@
+#include "IDCT.h"
+
+#if defined(__AVX2__)
+
+#include "IDCTKernel.h"
+#include <immintrin.h>
+
+namespace {
+
+// Eight int32_t lanes, one per column (first pass) or row (second pass).
+struct Vec {
+    __m256i v;
+
+    Vec() = default;
+    Vec(__m256i value) : v(value) {
+    }
+    Vec(int32_t value) : v(_mm256_set1_epi32(value)) {
+    }
+    Vec operator+(Vec other) const {
+        return _mm256_add_epi32(v, other.v);
+    }
+    Vec operator-(Vec other) const {
+        return _mm256_sub_epi32(v, other.v);
+    }
+    Vec operator*(int32_t factor) const {
+        return _mm256_mullo_epi32(v, _mm256_set1_epi32(factor));
+    }
+    Vec operator<<(int shift) const {
+        return _mm256_slli_epi32(v, shift);
+    }
+    Vec operator>>(int shift) const {
+        return _mm256_srai_epi32(v, shift);
+    }
+};
+
+void Transpose(Vec* rows) {
+    __m256i t0 = _mm256_unpacklo_epi32(rows[0].v, rows[1].v);
+    __m256i t1 = _mm256_unpackhi_epi32(rows[0].v, rows[1].v);
+    __m256i t2 = _mm256_unpacklo_epi32(rows[2].v, rows[3].v);
+    __m256i t3 = _mm256_unpackhi_epi32(rows[2].v, rows[3].v);
+    __m256i t4 = _mm256_unpacklo_epi32(rows[4].v, rows[5].v);
+    __m256i t5 = _mm256_unpackhi_epi32(rows[4].v, rows[5].v);
+    __m256i t6 = _mm256_unpacklo_epi32(rows[6].v, rows[7].v);
+    __m256i t7 = _mm256_unpackhi_epi32(rows[6].v, rows[7].v);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// With |Low| rows and columns 4-7 of the coefficients are known to be zero,
+// they are neither loaded nor transformed.
+template <bool Low>
+void InverseBlock(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                  size_t stride) {
+    Vec in[8];
+    Vec out[8];
+    for (size_t y = 0; y < (Low ? 4 : 8); ++y) {
+        __m256i c = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + y * 8)));
+        __m256i q = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(quant + y * 8)));
+        in[y] = _mm256_mullo_epi32(c, q);
+    }
+    if constexpr (Low) {
+        idct::Inverse1DLow<idct::kPass1Shift>(in, out);
+        Transpose(out);
+        idct::Inverse1DLow<idct::kPass2Shift>(out, in);
+    } else {
+        idct::Inverse1D<idct::kPass1Shift>(in, out);
+        Transpose(out);
+        idct::Inverse1D<idct::kPass2Shift>(out, in);
+    }
+    Transpose(in);
+
+    const __m256i offset = _mm256_set1_epi32(512);
+    const __m256i mask = _mm256_set1_epi32(1023);
+    const __m256i shift = _mm256_set1_epi32(384);
+    for (size_t y = 0; y < 8; ++y) {
+        __m256i value = _mm256_and_si256(_mm256_add_epi32(in[y].v, offset), mask);
+        value = _mm256_sub_epi32(value, shift);
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(value),
+                                        _mm256_extracti128_si256(value, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + y * stride),
+                         _mm_packus_epi16(words, words));
+    }
+}
+
+class AVX2IDCT : public IDCTBackend {
+public:
+    virtual IDCTBackendType Type() const override {
+        return IDCTBackendType::AVX2;
+    }
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const override {
+        InverseBlock<false>(coefficients, quant, output, stride);
+    }
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const override {
+        InverseBlock<true>(coefficients, quant, output, stride);
+    }
+};
+
+}  // namespace
+
+const IDCTBackend* GetAVX2IDCTBackend() {
+    static const AVX2IDCT kBackend;
+    return &kBackend;
+}
+
+#else
+
+const IDCTBackend* GetAVX2IDCTBackend() {
+    return nullptr;
+}
+
+#endif
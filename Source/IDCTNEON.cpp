@@ -0,0 +1,134 @@
+#include "IDCT.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include "IDCTKernel.h"
+#include <arm_neon.h>
+
+namespace {
+
+// Four int32_t lanes, the 8x8 block is processed as two halves.
+struct Vec {
+    int32x4_t v;
+
+    Vec() = default;
+    Vec(int32x4_t value) : v(value) {
+    }
+    Vec(int32_t value) : v(vdupq_n_s32(value)) {
+    }
+    Vec operator+(Vec other) const {
+        return vaddq_s32(v, other.v);
+    }
+    Vec operator-(Vec other) const {
+        return vsubq_s32(v, other.v);
+    }
+    Vec operator*(int32_t factor) const {
+        return vmulq_n_s32(v, factor);
+    }
+    Vec operator<<(int shift) const {
+        return vshlq_s32(v, vdupq_n_s32(shift));
+    }
+    Vec operator>>(int shift) const {
+        return vshlq_s32(v, vdupq_n_s32(-shift));
+    }
+};
+
+// Transposes 4x4 block given by rows |in| into |out|.
+void Transpose(const Vec* in, Vec* out) {
+    int32x4x2_t t01 = vtrnq_s32(in[0].v, in[1].v);
+    int32x4x2_t t23 = vtrnq_s32(in[2].v, in[3].v);
+    out[0] = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0]));
+    out[1] = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1]));
+    out[2] = vcombine_s32(vget_high_s32(t01.val[0]), vget_high_s32(t23.val[0]));
+    out[3] = vcombine_s32(vget_high_s32(t01.val[1]), vget_high_s32(t23.val[1]));
+}
+
+// With |Low| the right half of the first pass and the bottom half of its
+// input are known to be zero and are not computed.
+template <bool Low>
+void InverseBlock(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                  size_t stride) {
+    // Columns 0-3 and 4-7 of the first pass, lanes are columns.
+    Vec left[8], right[8];
+    {
+        Vec in_left[8], in_right[8];
+        for (size_t y = 0; y < (Low ? 4 : 8); ++y) {
+            int16x8_t c = vld1q_s16(coefficients + y * 8);
+            int32x4_t q_low = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(quant + y * 8)));
+            int32x4_t q_high = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(quant + y * 8 + 4)));
+            in_left[y] = vmulq_s32(vmovl_s16(vget_low_s16(c)), q_low);
+            in_right[y] = vmulq_s32(vmovl_s16(vget_high_s16(c)), q_high);
+        }
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass1Shift>(in_left, left);
+        } else {
+            idct::Inverse1D<idct::kPass1Shift>(in_left, left);
+            idct::Inverse1D<idct::kPass1Shift>(in_right, right);
+        }
+    }
+
+    // Rows 0-3 and 4-7 of the second pass, lanes are rows.
+    Vec top[8], bottom[8];
+    {
+        Vec in_top[8], in_bottom[8];
+        Transpose(left, in_top);
+        Transpose(left + 4, in_bottom);
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass2Shift>(in_top, top);
+            idct::Inverse1DLow<idct::kPass2Shift>(in_bottom, bottom);
+        } else {
+            Transpose(right, in_top + 4);
+            Transpose(right + 4, in_bottom + 4);
+            idct::Inverse1D<idct::kPass2Shift>(in_top, top);
+            idct::Inverse1D<idct::kPass2Shift>(in_bottom, bottom);
+        }
+    }
+
+    Vec rows[16];
+    Transpose(top, rows);
+    Transpose(top + 4, rows + 4);
+    Transpose(bottom, rows + 8);
+    Transpose(bottom + 4, rows + 12);
+
+    const int32x4_t offset = vdupq_n_s32(512);
+    const int32x4_t mask = vdupq_n_s32(1023);
+    const int32x4_t shift = vdupq_n_s32(384);
+    auto limit = [&](Vec value) {
+        return vqmovn_s32(vsubq_s32(vandq_s32(vaddq_s32(value.v, offset), mask), shift));
+    };
+    for (size_t y = 0; y < 8; ++y) {
+        size_t block = (y / 4) * 8 + y % 4;
+        int16x8_t words = vcombine_s16(limit(rows[block]), limit(rows[block + 4]));
+        vst1_u8(output + y * stride, vqmovun_s16(words));
+    }
+}
+
+class NEONIDCT : public IDCTBackend {
+public:
+    virtual IDCTBackendType Type() const override {
+        return IDCTBackendType::NEON;
+    }
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const override {
+        InverseBlock<false>(coefficients, quant, output, stride);
+    }
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const override {
+        InverseBlock<true>(coefficients, quant, output, stride);
+    }
+};
+
+}  // namespace
+
+const IDCTBackend* GetNEONIDCTBackend() {
+    static const NEONIDCT kBackend;
+    return &kBackend;
+}
+
+#else
+
+const IDCTBackend* GetNEONIDCTBackend() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "IDCT.h"
+#include "IDCTKernel.h"
+#include "Exceptions.h"
+
+namespace {
+
+using idct::Descale;
+using idct::kConstBits;
+using idct::kFix_0_765366865;
+using idct::kFix_0_899976223;
+using idct::kFix_1_847759065;
+using idct::kFix_2_562915447;
+using idct::kPass1Bits;
+using idct::RangeLimit;
+
+// Constants of libjpeg's jidctred, which are not used by the full transform.
+constexpr int32_t kFix_0_211164243 = 1730;
+constexpr int32_t kFix_0_509795579 = 4176;
+constexpr int32_t kFix_0_601344887 = 4926;
+constexpr int32_t kFix_0_720959822 = 5906;
+constexpr int32_t kFix_0_850430095 = 6967;
+constexpr int32_t kFix_1_061594337 = 8697;
+constexpr int32_t kFix_1_272758580 = 10426;
+constexpr int32_t kFix_1_451774981 = 11893;
+constexpr int32_t kFix_2_172734803 = 17799;
+constexpr int32_t kFix_3_624509785 = 29692;
+
+// 4 point transform of the even (0, 2, 6) and odd (1, 3, 5, 7) inputs, row 4
+// does not contribute to the 4 outputs.
+template <int Shift>
+void Inverse4(const int64_t* in, int64_t* out) {
+    int64_t tmp0 = in[0] * (1 << (kConstBits + 1));
+    int64_t tmp2 = in[2] * kFix_1_847759065 + in[6] * -kFix_0_765366865;
+    int64_t tmp10 = tmp0 + tmp2;
+    int64_t tmp12 = tmp0 - tmp2;
+
+    tmp0 = in[7] * -kFix_0_211164243 + in[5] * kFix_1_451774981 + in[3] * -kFix_2_172734803 +
+           in[1] * kFix_1_061594337;
+    tmp2 = in[7] * -kFix_0_509795579 + in[5] * -kFix_0_601344887 + in[3] * kFix_0_899976223 +
+           in[1] * kFix_2_562915447;
+
+    out[0] = Descale<Shift>(tmp10 + tmp2);
+    out[3] = Descale<Shift>(tmp10 - tmp2);
+    out[1] = Descale<Shift>(tmp12 + tmp0);
+    out[2] = Descale<Shift>(tmp12 - tmp0);
+}
+
+// 2 point transform, only the odd inputs and the DC contribute.
+template <int Shift>
+void Inverse2(const int64_t* in, int64_t* out) {
+    int64_t tmp10 = in[0] * (1 << (kConstBits + 2));
+    int64_t tmp0 = in[7] * -kFix_0_720959822 + in[5] * kFix_0_850430095 +
+                   in[3] * -kFix_1_272758580 + in[1] * kFix_3_624509785;
+    out[0] = Descale<Shift>(tmp10 + tmp0);
+    out[1] = Descale<Shift>(tmp10 - tmp0);
+}
+
+// Columns are transformed first, then rows of the |Size| x 8 workspace. As in
+// libjpeg the sums are 64 bit and the workspace keeps them truncated to int.
+template <size_t Size, class Transform1, class Transform2>
+void InverseScaled(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                   size_t stride, Transform1 columns, Transform2 rows) {
+    int32_t workspace[Size * 8] = {};
+    int64_t in[8];
+    int64_t out[Size];
+    for (size_t x = 0; x < 8; ++x) {
+        // Only odd columns and the first one reach the outputs of a 2 point
+        // transform, all but the column 4 those of a 4 point one.
+        if ((Size == 2 && x != 0 && x % 2 == 0) || (Size == 4 && x == 4)) {
+            continue;
+        }
+        for (size_t y = 0; y < 8; ++y) {
+            in[y] = static_cast<int64_t>(coefficients[y * 8 + x]) * quant[y * 8 + x];
+        }
+        columns(in, out);
+        for (size_t y = 0; y < Size; ++y) {
+            workspace[y * 8 + x] = static_cast<int32_t>(out[y]);
+        }
+    }
+    for (size_t y = 0; y < Size; ++y) {
+        std::copy_n(workspace + y * 8, 8, in);
+        rows(in, out);
+        for (size_t x = 0; x < Size; ++x) {
+            output[y * stride + x] = RangeLimit(out[x]);
+        }
+    }
+}
+
+}  // namespace
+
+void InverseReduced(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                    size_t stride, size_t size) {
+    switch (size) {
+        case 4:
+            InverseScaled<4>(coefficients, quant, output, stride,
+                             Inverse4<kConstBits - kPass1Bits + 1>,
+                             Inverse4<kConstBits + kPass1Bits + 3 + 1>);
+            return;
+        case 2:
+            InverseScaled<2>(coefficients, quant, output, stride,
+                             Inverse2<kConstBits - kPass1Bits + 2>,
+                             Inverse2<kConstBits + kPass1Bits + 3 + 2>);
+            return;
+        case 1:
+            // DC only, AC coefficients are not even dequantized.
+            *output = RangeLimit(Descale<3>(static_cast<int32_t>(coefficients[0]) * quant[0]));
+            return;
+    }
+    THROW_IF(true, "Unsupported reduced transform size.");
+}
@@ -0,0 +1,137 @@
+#include "IDCT.h"
+
+#if defined(__SSE4_1__)
+
+#include "IDCTKernel.h"
+#include <smmintrin.h>
+
+namespace {
+
+// Four int32_t lanes, the 8x8 block is processed as two halves.
+struct Vec {
+    __m128i v;
+
+    Vec() = default;
+    Vec(__m128i value) : v(value) {
+    }
+    Vec(int32_t value) : v(_mm_set1_epi32(value)) {
+    }
+    Vec operator+(Vec other) const {
+        return _mm_add_epi32(v, other.v);
+    }
+    Vec operator-(Vec other) const {
+        return _mm_sub_epi32(v, other.v);
+    }
+    Vec operator*(int32_t factor) const {
+        return _mm_mullo_epi32(v, _mm_set1_epi32(factor));
+    }
+    Vec operator<<(int shift) const {
+        return _mm_slli_epi32(v, shift);
+    }
+    Vec operator>>(int shift) const {
+        return _mm_srai_epi32(v, shift);
+    }
+};
+
+// Transposes 4x4 block given by rows |in| into |out|.
+void Transpose(const Vec* in, Vec* out) {
+    __m128i t0 = _mm_unpacklo_epi32(in[0].v, in[1].v);
+    __m128i t1 = _mm_unpackhi_epi32(in[0].v, in[1].v);
+    __m128i t2 = _mm_unpacklo_epi32(in[2].v, in[3].v);
+    __m128i t3 = _mm_unpackhi_epi32(in[2].v, in[3].v);
+    out[0] = _mm_unpacklo_epi64(t0, t2);
+    out[1] = _mm_unpackhi_epi64(t0, t2);
+    out[2] = _mm_unpacklo_epi64(t1, t3);
+    out[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+// With |Low| the right half of the first pass and the bottom half of its
+// input are known to be zero and are not computed.
+template <bool Low>
+void InverseBlock(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                  size_t stride) {
+    // Columns 0-3 and 4-7 of the first pass, lanes are columns.
+    Vec left[8], right[8];
+    {
+        Vec in_left[8], in_right[8];
+        for (size_t y = 0; y < (Low ? 4 : 8); ++y) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + y * 8));
+            __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(quant + y * 8));
+            in_left[y] = _mm_mullo_epi32(_mm_cvtepi16_epi32(c), _mm_cvtepu16_epi32(q));
+            in_right[y] = _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(c, 8)),
+                                          _mm_cvtepu16_epi32(_mm_srli_si128(q, 8)));
+        }
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass1Shift>(in_left, left);
+        } else {
+            idct::Inverse1D<idct::kPass1Shift>(in_left, left);
+            idct::Inverse1D<idct::kPass1Shift>(in_right, right);
+        }
+    }
+
+    // Rows 0-3 and 4-7 of the second pass, lanes are rows.
+    Vec top[8], bottom[8];
+    {
+        Vec in_top[8], in_bottom[8];
+        Transpose(left, in_top);
+        Transpose(left + 4, in_bottom);
+        if constexpr (Low) {
+            idct::Inverse1DLow<idct::kPass2Shift>(in_top, top);
+            idct::Inverse1DLow<idct::kPass2Shift>(in_bottom, bottom);
+        } else {
+            Transpose(right, in_top + 4);
+            Transpose(right + 4, in_bottom + 4);
+            idct::Inverse1D<idct::kPass2Shift>(in_top, top);
+            idct::Inverse1D<idct::kPass2Shift>(in_bottom, bottom);
+        }
+    }
+
+    Vec rows[16];
+    Transpose(top, rows);
+    Transpose(top + 4, rows + 4);
+    Transpose(bottom, rows + 8);
+    Transpose(bottom + 4, rows + 12);
+
+    const __m128i offset = _mm_set1_epi32(512);
+    const __m128i mask = _mm_set1_epi32(1023);
+    const __m128i shift = _mm_set1_epi32(384);
+    auto limit = [&](Vec value) {
+        return _mm_sub_epi32(_mm_and_si128(_mm_add_epi32(value.v, offset), mask), shift);
+    };
+    for (size_t y = 0; y < 8; ++y) {
+        size_t block = (y / 4) * 8 + y % 4;
+        __m128i words = _mm_packs_epi32(limit(rows[block]), limit(rows[block + 4]));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + y * stride),
+                         _mm_packus_epi16(words, words));
+    }
+}
+
+class SSE41IDCT : public IDCTBackend {
+public:
+    virtual IDCTBackendType Type() const override {
+        return IDCTBackendType::SSE41;
+    }
+    virtual void Inverse(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                         size_t stride) const override {
+        InverseBlock<false>(coefficients, quant, output, stride);
+    }
+    virtual void InverseLow(const int16_t* coefficients, const uint16_t* quant, uint8_t* output,
+                            size_t stride) const override {
+        InverseBlock<true>(coefficients, quant, output, stride);
+    }
+};
+
+}  // namespace
+
+const IDCTBackend* GetSSE41IDCTBackend() {
+    static const SSE41IDCT kBackend;
+    return &kBackend;
+}
+
+#else
+
+const IDCTBackend* GetSSE41IDCTBackend() {
+    return nullptr;
+}
+
+#endif
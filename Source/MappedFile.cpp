@@ -0,0 +1,55 @@
+#include "MappedFile.h"
+#include "Exceptions.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JPEG_DECODER_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef JPEG_DECODER_HAS_MMAP
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    DATA_ERROR_IF(fd < 0, "Specified file is not valid");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        DATA_ERROR_IF(true, "Specified file is not valid");
+    }
+    size_ = info.st_size;
+    if (size_ == 0) {
+        close(fd);
+        return;
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced, the descriptor is not needed anymore.
+    close(fd);
+    DATA_ERROR_IF(data == MAP_FAILED, "Failed to map file.");
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t*>(data);
+    mapped_ = true;
+}
+
+MappedFile::~MappedFile() {
+    if (mapped_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    DATA_ERROR_IF(!file.is_open(), "Specified file is not valid");
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile() {
+}
+
+#endif
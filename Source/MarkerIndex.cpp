@@ -0,0 +1,67 @@
+#include "MarkerIndex.h"
+#include "Section.h"
+
+namespace {
+
+// Array growing in the arena, storage it outgrows is left to the arena.
+template <class T>
+class ArenaArray {
+public:
+    ArenaArray(Arena& arena, size_t capacity) : arena_(arena), data_(arena.CreateArray<T>(capacity)) {
+    }
+    void Push(const T& value) {
+        if (size_ == data_.size()) {
+            auto data = arena_.CreateArray<T>(data_.size() * 2);
+            std::copy(data_.begin(), data_.end(), data.begin());
+            data_ = data;
+        }
+        data_[size_++] = value;
+    }
+    std::span<T> Span() const {
+        return data_.first(size_);
+    }
+
+private:
+    Arena& arena_;
+    std::span<T> data_;
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+MarkerIndex BuildMarkerIndex(std::span<const uint8_t> data, Arena& arena, bool headers_only) {
+    // A typical file has a dozen of segments.
+    ArenaArray<MarkerEntry> markers(arena, 16);
+    ArenaArray<size_t> restarts(arena, 16);
+    size_t size = data.size();
+    size_t pos = 0;
+    while (pos != size) {
+        DATA_ERROR_IF(pos + 1 >= size, "Unexpected end of data.");
+        uint8_t marker = data[pos + 1];
+        SECTION_ERROR_IF(data[pos] != 0xff || MarkerSectionType(marker) == SectionType::None,
+                         "Unknow current section.");
+        size_t end = pos + 2;
+        // Headers read from a stream may end right after the marker of the first scan.
+        if (marker == 0xda && headers_only) {
+            markers.Push({marker, pos, end});
+            break;
+        }
+        if (HasLength(marker)) {
+            SECTION_ERROR_IF(pos + 4 > size, "Section to small for its length.");
+            size_t length = (data[pos + 2] << 8) + data[pos + 3];
+            SECTION_ERROR_IF(length < 2, "Wrong section length.");
+            end += length;
+            SECTION_ERROR_IF(end > size, "Section to small for its specified length.");
+        }
+        if (marker == 0xda) {
+            end = FindScanEnd(data.data(), end, size, [&](size_t offset) { restarts.Push(offset); });
+            SECTION_ERROR_IF(end == size, "Failed to find end of scan data.");
+        }
+        markers.Push({marker, pos, end});
+        if (marker == 0xd9) {
+            break;
+        }
+        pos = end;
+    }
+    return {markers.Span(), restarts.Span()};
+}
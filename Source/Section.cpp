@@ -10,7 +10,7 @@ void CommentSection::Process(DecoderData& data) {
     for (size_t i = 0; i < stream_.Size(); ++i) {
         comment[i] = stream_[i];
     }
-    data.image.SetComment(comment);
+    data.comment = comment;
 }
 void DQTSection::Process(DecoderData& data) {
     while (stream_.Size() > 0) {
@@ -24,13 +24,11 @@ void DQTSection::Process(DecoderData& data) {
         while (data.dqts.size() <= id) {
             data.dqts.push_back({});
         }
-        data.dqts[id].table = std::vector<int64_t>(64, 0);
         for (size_t i = 0; i < 64; ++i) {
             if (bytes == 0) {
-                data.dqts[id].table[kTransformX[i] + kTransformY[i] * 8] = stream_[i + 1];
+                data.dqts[id].table[kZigZag[i]] = stream_[i + 1];
             } else {
-                data.dqts[id].table[kTransformX[i] + kTransformY[i] * 8] =
-                    (stream_[2 * i + 1] << 8) + stream_[2 * i + 2];
+                data.dqts[id].table[kZigZag[i]] = (stream_[2 * i + 1] << 8) + stream_[2 * i + 2];
             }
         }
         data.dqts[id].valid = true;
@@ -43,10 +41,10 @@ void DQTSection::Process(DecoderData& data) {
 }
 void ImageInfoSection::Process(DecoderData& data) {
     // SECTION_ERROR_IF(stream_.Size() < 6, "ImageInfo to short.");
+    data.progressive = progressive_;
     data.presicion = stream_[0];
     data.height = (stream_[1] << 8) + stream_[2];
     data.width = (stream_[3] << 8) + stream_[4];
-    data.image.SetSize(data.width, data.height);
     data.channels.resize(stream_[5]);
     // SECTION_ERROR_IF(stream_.Size() != 6ull + 3ull * stream_[5], "Wrong ImageInfo size.");
 
@@ -83,48 +81,81 @@ void HuffmanSection::Process(DecoderData& data) {
         while (ac_dc_vec->size() <= id) {
             ac_dc_vec->push_back({});
         }
-        std::vector<uint8_t> code_lengths(16);
+        std::array<uint8_t, 16> code_lengths;
         size_t values_amount = 0;
         for (size_t i = 0; i < 16; ++i) {
             code_lengths[i] = stream_[i + 1];
             values_amount += stream_[i + 1];
         }
-        std::vector<uint8_t> values(values_amount);
+        std::array<uint8_t, 256> values;
+        DATA_ERROR_IF(values_amount > values.size(), "To many values.");
         // SECTION_ERROR_IF(stream_.Size() < 17 + values_amount, "To small Huffman.");
 
         for (size_t i = 0; i < values_amount; ++i) {
             values[i] = static_cast<size_t>(stream_[i + 17]);
         }
         stream_.MoveBegin(17 + values_amount);
-        ac_dc_vec->back().valid = true;
-        ac_dc_vec->back().tree.Build(code_lengths, values);
+        (*ac_dc_vec)[id].valid = true;
+        (*ac_dc_vec)[id].tree.Build(code_lengths, std::span(values.data(), values_amount));
     }
 }
-void ImageDataSection::Process(DecoderData& data) {
+void RestartIntervalSection::Process(DecoderData& data) {
+    DATA_ERROR_IF(stream_.Size() != 2, "Wrong RestartInterval size.");
+    data.restart_interval = (stream_[0] << 8) + stream_[1];
+}
+void ImageDataSection::ProcessHeader(DecoderData& data) {
     // SECTION_ERROR_IF(stream_.Size() < 1, "To small ImageData.");
     size_t c_amount = stream_[0];
-    DATA_ERROR_IF(c_amount != data.channels.size(), "Channel amount mismatch.");
+    DATA_ERROR_IF(c_amount == 0 || c_amount > data.channels.size(), "Channel amount mismatch.");
     // SECTION_ERROR_IF(stream_.Size() < 4 + 2 * c_amount, "To small to contain channel info.");
+    ScanInfo scan;
+    scan.channels = data.arena.CreateArray<size_t>(c_amount);
     for (size_t i = 1; i < 1 + 2 * c_amount; i += 2) {
         size_t c_id = stream_[i] - 1;
         size_t dc_id = Last(stream_[i + 1]);
         size_t ac_id = First(stream_[i + 1]);
-        DATA_ERROR_IF(c_id >= c_amount || !data.channels[c_id].valid, "Wrong channel id.");
+        DATA_ERROR_IF(c_id >= data.channels.size() || !data.channels[c_id].valid, "Wrong channel id.");
         data.channels[c_id].dc_id = dc_id;
         data.channels[c_id].ac_id = ac_id;
         data.channels[c_id].valid_ac_dc = true;
+        scan.channels[i / 2] = c_id;
     }
-    DATA_ERROR_IF(stream_[1 + 2 * c_amount] != 0, "Wrong prog.");
-    DATA_ERROR_IF(stream_[2 + 2 * c_amount] != 0x3f, "Wrong prog.");
-    DATA_ERROR_IF(stream_[3 + 2 * c_amount] != 0, "Wrong prog.");
-    data.PreValidateImageData();
+    scan.ss = stream_[1 + 2 * c_amount];
+    scan.se = stream_[2 + 2 * c_amount];
+    scan.ah = Last(stream_[3 + 2 * c_amount]);
+    scan.al = First(stream_[3 + 2 * c_amount]);
+    if (data.progressive) {
+        DATA_ERROR_IF(scan.ss > scan.se || scan.se > 63, "Wrong spectral selection.");
+        DATA_ERROR_IF(scan.ss == 0 && scan.se != 0, "DC and AC in one progressive scan.");
+        DATA_ERROR_IF(scan.ss != 0 && c_amount != 1, "Interleaved progressive AC scan.");
+        DATA_ERROR_IF(scan.al > 13 || (scan.ah != 0 && scan.ah != scan.al + 1),
+                      "Wrong successive approximation.");
+    } else {
+        DATA_ERROR_IF(scan.ss != 0, "Wrong prog.");
+        DATA_ERROR_IF(scan.se != 0x3f, "Wrong prog.");
+        DATA_ERROR_IF(scan.ah != 0 || scan.al != 0, "Wrong prog.");
+    }
+    data.BeginScan(scan);
     stream_.MoveBegin(4 + 2 * c_amount);
+}
+void ImageDataSection::Process(DecoderData& data) {
+    {
+        StageTimer timer(data.stats, DecodeStage::HeaderParse);
+        ProcessHeader(data);
+    }
 
     // for (size_t i = 0; i < stream_.BitSize(); ++i) {
     //     std::cout << stream_.bit(i);
     // }
     // std::cout << std::endl;
 
+    // Intervals decoded in parallel finish out of order, so they need the whole
+    // frame. Otherwise a single scan has every MCU row finished right after it is read.
+    if (data.options.parallel_restart_intervals && data.restart_interval != 0) {
+        size_t begin = stream_.Offset();
+        ReadDataParallel(stream_, data.markers.RestartsIn(begin, begin + stream_.Size()), data);
+        return;
+    }
     MCUReader reader(stream_, data);
     reader.ReadData();
 }
@@ -145,6 +176,8 @@ std::string SectionTypeToString(SectionType type) {
             return "ImageInfo";
         case SectionType::Huffman:
             return "Huffman";
+        case SectionType::RestartInterval:
+            return "RestartInterval";
         case SectionType::ImageData:
             return "ImageData";
         case SectionType::Application:
@@ -2,52 +2,78 @@
 #include <iostream>
 #include <algorithm>
 
-std::shared_ptr<Section> SectionDetecter::CreateCurrentSection() {
-    int ff = stream_[pos_];
-    int marker = stream_[pos_ + 1];
-    SECTION_ERROR_IF(ff != 255, "Unknow current section.");
+SectionType MarkerSectionType(uint8_t marker) {
     if (0xe0 <= marker && marker <= 0xef) {
-        return std::make_shared<ApplicationSection>(stream_, pos_);
+        return SectionType::Application;
     }
     switch (marker) {
         case 0xd8:
-            return std::make_shared<BeginSection>(stream_, pos_);
-            break;
+            return SectionType::Begin;
         case 0xd9:
-            return std::make_shared<EndSection>(stream_, pos_);
-            break;
+            return SectionType::End;
         case 0xfe:
-            return std::make_shared<CommentSection>(stream_, pos_);
-            break;
+            return SectionType::Comment;
         case 0xdb:
-            return std::make_shared<DQTSection>(stream_, pos_);
-            break;
+            return SectionType::DQT;
         case 0xda:
-            return std::make_shared<ImageDataSection>(stream_, pos_);
-            break;
+            return SectionType::ImageData;
         case 0xc0:
-            return std::make_shared<ImageInfoSection>(stream_, pos_);
-            break;
+        case 0xc2:
+            return SectionType::ImageInfo;
         case 0xc4:
-            return std::make_shared<HuffmanSection>(stream_, pos_);
-            break;
+            return SectionType::Huffman;
+        case 0xdd:
+            return SectionType::RestartInterval;
         default:
-            SECTION_ERROR_IF(true, "Unknow current section.");
+            return SectionType::None;
+    }
+}
+
+Section* SectionDetecter::CreateSection(const MarkerEntry& entry, Arena& arena) {
+    switch (MarkerSectionType(entry.marker)) {
+        case SectionType::Begin:
+            return arena.Create<BeginSection>(stream_, entry);
+        case SectionType::End:
+            return arena.Create<EndSection>(stream_, entry);
+        case SectionType::Comment:
+            return arena.Create<CommentSection>(stream_, entry);
+        case SectionType::Application:
+            return arena.Create<ApplicationSection>(stream_, entry);
+        case SectionType::DQT:
+            return arena.Create<DQTSection>(stream_, entry);
+        case SectionType::ImageData:
+            return arena.Create<ImageDataSection>(stream_, entry);
+        case SectionType::ImageInfo:
+            return arena.Create<ImageInfoSection>(stream_, entry);
+        case SectionType::Huffman:
+            return arena.Create<HuffmanSection>(stream_, entry);
+        case SectionType::RestartInterval:
+            return arena.Create<RestartIntervalSection>(stream_, entry);
+        case SectionType::None:
             break;
     }
+    SECTION_ERROR_IF(true, "Unknow current section.");
 }
 
 SectionDetecter::SectionDetecter(const StreamNavigator& stream) : stream_(stream) {
 }
 void SectionDetecter::GetSections(DecoderData& dec) {
-    while (pos_ != stream_.Size()) {
-        auto section = CreateCurrentSection();
-        pos_ = section->FindEnd();
-        dec.sections.push_back(section);
-        if (section->Type() == SectionType::End) {
-            break;
+    dec.markers = BuildMarkerIndex(std::span<const uint8_t>(stream_.Data(), stream_.Size()), dec.arena);
+    // Tables may be redefined between scans, so they keep their order relative to scans.
+    // Entries are sorted rather than sections, ties are broken by file offsets.
+    auto rank = [](const MarkerEntry& entry) {
+        SectionType type = MarkerSectionType(entry.marker);
+        if (type == SectionType::RestartInterval || type == SectionType::ImageData) {
+            return SectionType::Huffman;
         }
+        return type;
+    };
+    auto order = dec.arena.CreateArray<MarkerEntry>(dec.markers.markers.size());
+    std::copy(dec.markers.markers.begin(), dec.markers.markers.end(), order.begin());
+    std::sort(order.begin(), order.end(), [&](const MarkerEntry& a, const MarkerEntry& b) {
+        return std::make_pair(rank(a), a.begin) < std::make_pair(rank(b), b.begin);
+    });
+    for (const auto& entry : order) {
+        dec.sections.push_back(CreateSection(entry, dec.arena));
     }
-    std::sort(dec.sections.begin(), dec.sections.end(),
-              [](const auto& a, const auto& b) { return a->Type() < b->Type(); });
 }
@@ -0,0 +1,344 @@
+#include "StreamingDecoder.h"
+#include "StreamNavigator.h"
+#include "SectionDetector.h"
+#include "MCUReader.h"
+
+//___Impl______________________________________________________________________________________________________________________
+
+// Data is kept from the first byte not consumed yet. Markers are processed in
+// file order as soon as their segments are complete, entropy coded data is read
+// an MCU row at a time. A row which runs out of data is rolled back to the
+// checkpoint before it and read again once more data arrives.
+class StreamingDecoder::Impl
+{
+public:
+    explicit Impl(const DecodeOptions& options)
+    {
+        data_.options = options;
+        // Intervals decoded in parallel need the whole scan.
+        data_.options.parallel_restart_intervals = false;
+        data_.stats.Begin(options.stats);
+    }
+
+    void Feed(std::span<const uint8_t> chunk)
+    {
+        INVALID_ARGUMENT_IF(finished_, "Data fed after Finish.");
+        buffer_.insert(buffer_.end(), chunk.begin(), chunk.end());
+        Advance();
+    }
+
+    void Finish()
+    {
+        finished_ = true;
+        Advance();
+        DATA_ERROR_IF(stage_ != Stage::Done, "Unexpected end of data.");
+    }
+
+    bool              HasInfo() const { return has_info_; }
+    const OutputInfo& Info() const
+    {
+        THROW_IF(!has_info_, "Frame header is not read yet.");
+        return info_;
+    }
+    bool  Done() const { return stage_ == Stage::Done; }
+    Image TakeImage()
+    {
+        THROW_IF(stage_ != Stage::Done, "Image is not decoded yet.");
+        image_.SetComment(data_.comment);
+        return std::move(image_);
+    }
+
+    RowsCallback rows_callback;
+    ScanCallback scan_callback;
+
+private:
+    enum class Stage
+    {
+        Markers,
+        ScanData,
+        Done
+    };
+
+    void Advance()
+    {
+        bool progress = true;
+        while (progress)
+        {
+            switch (stage_)
+            {
+                case Stage::Markers: progress = ReadMarker(); break;
+                case Stage::ScanData: progress = ReadScanData(); break;
+                case Stage::Done: progress = false; break;
+            }
+        }
+        if (stage_ == Stage::ScanData && !data_.full_frame)
+        {
+            ReportRows(data_.FinishedRows());
+        }
+        Compact();
+    }
+
+    // Processes the segment at pos_, returns false if it is not complete yet.
+    bool ReadMarker()
+    {
+        if (pos_ + 2 > buffer_.size())
+        {
+            return false;
+        }
+        SECTION_ERROR_IF(buffer_[pos_] != 0xff, "Unknow current section.");
+        uint8_t marker = buffer_[pos_ + 1];
+        size_t  end    = pos_ + 2;
+        if (HasLength(marker))
+        {
+            if (pos_ + 4 > buffer_.size())
+            {
+                return false;
+            }
+            size_t length = (buffer_[pos_ + 2] << 8) + buffer_[pos_ + 3];
+            SECTION_ERROR_IF(length < 2, "Wrong section length.");
+            end += length;
+            if (end > buffer_.size())
+            {
+                return false;
+            }
+        }
+
+        // The entry of a scan ends with its header, the entropy coded data is read row by row.
+        StreamNavigator stream(std::span<const uint8_t>(buffer_.data(), end));
+        auto            section = SectionDetecter(stream).CreateSection({marker, pos_, end}, data_.arena);
+        if (section->Type() == SectionType::ImageData)
+        {
+            StageTimer timer(data_.stats, DecodeStage::HeaderParse);
+            if (!has_info_ && !frame_segment_.empty())
+            {
+                BeginFrame();
+            }
+            static_cast<ImageDataSection*>(section)->ProcessHeader(data_);
+            BeginScanData(end);
+            return true;
+        }
+        size_t begin = pos_;
+        pos_         = end;
+        // Rows left are processed at the end of the image, which is timed by their stages.
+        if (section->Type() == SectionType::End)
+        {
+            FinishFrame();
+            return true;
+        }
+        // Tables may come after the frame header, like Decoder the frame is
+        // processed once all of them before the first scan are.
+        if (section->Type() == SectionType::ImageInfo)
+        {
+            SECTION_ERROR_IF(!frame_segment_.empty(), "Wrong amount of ImageInfo sections.");
+            frame_segment_.assign(buffer_.begin() + begin, buffer_.begin() + end);
+            return true;
+        }
+        StageTimer timer(data_.stats, DecodeStage::HeaderParse);
+        section->Process(data_);
+        return true;
+    }
+
+    // Processes the frame header kept by ReadMarker and allocates the image.
+    void BeginFrame()
+    {
+        StreamNavigator stream(frame_segment_);
+        auto            section = SectionDetecter(stream).CreateSection(
+            {frame_segment_[1], 0, frame_segment_.size()}, data_.arena);
+        section->Process(data_);
+        info_.width   = data_.out_width;
+        info_.height  = data_.out_height;
+        info_.format  = data_.options.pixel_format;
+        info_.comment = data_.comment;
+        has_info_     = true;
+        image_        = Image(info_.width, info_.height, info_.format);
+        data_.output  = image_.View();
+    }
+
+    void BeginScanData(size_t begin)
+    {
+        pos_        = begin;
+        next_row_   = 0;
+        row_bytes_  = 0;
+        retry_size_ = 0;
+        stage_      = Stage::ScanData;
+        reader_.emplace(EntropyData(), data_);
+    }
+
+    StreamNavigator EntropyData() const
+    {
+        return StreamNavigator(std::span<const uint8_t>(buffer_.data() + pos_, buffer_.size() - pos_));
+    }
+
+    // Reads MCU rows of the scan the region needs while the data suffices,
+    // returns true once the scan is over and the next marker is found.
+    bool ReadScanData()
+    {
+        if (reader_)
+        {
+            reader_->Resume(EntropyData());
+            while (next_row_ < data_.scan.needed.y_end)
+            {
+                if (!finished_ && buffer_.size() < retry_size_)
+                {
+                    return false;
+                }
+                if (!ReadRow(next_row_))
+                {
+                    retry_size_ = buffer_.size() + row_bytes_ / 2;
+                    return false;
+                }
+                ++next_row_;
+            }
+            pos_ += reader_->Position();
+            reader_.reset();
+        }
+
+        // Fill bits, MCUs of rows after the region and the marker ending the scan.
+        size_t end = FindScanEnd(buffer_.data(), pos_, buffer_.size(), [](size_t) {});
+        if (end != buffer_.size())
+        {
+            pos_   = end;
+            stage_ = Stage::Markers;
+            FinishScan();
+            return true;
+        }
+        // The last byte may start the marker.
+        pos_ = std::max(pos_, buffer_.empty() ? 0 : buffer_.size() - 1);
+        return false;
+    }
+
+    // Reads MCU row |row| or rolls back to the state before it if the data ends.
+    bool ReadRow(size_t row)
+    {
+        const ScanInfo& scan       = data_.scan;
+        size_t          begin      = reader_->Position();
+        auto            checkpoint = reader_->Save();
+        // Refinement of AC coefficients depends on the ones already read, so the
+        // blocks are restored as well.
+        int16_t* blocks = nullptr;
+        size_t   size   = 0;
+        if (data_.progressive && scan.ss != 0 && scan.ah != 0)
+        {
+            Channel& channel = data_.channels[scan.channels[0]];
+            blocks           = channel.Block(0, row);
+            size             = channel.blocks_per_line * 64;
+            saved_blocks_.assign(blocks, blocks + size);
+        }
+        try
+        {
+            StageTimer timer(data_.stats, DecodeStage::EntropyDecode);
+            reader_->ReadMCUs(row * scan.mcu_x_cnt, std::min((row + 1) * scan.mcu_x_cnt, scan.mcu_cnt));
+        } catch (const DataError&)
+        {
+            if (finished_ || !reader_->Starved())
+            {
+                throw;
+            }
+            reader_->Restore(checkpoint);
+            if (blocks)
+            {
+                std::copy(saved_blocks_.begin(), saved_blocks_.begin() + size, blocks);
+            }
+            return false;
+        }
+        row_bytes_ = reader_->Position() - begin;
+        if (!data_.full_frame)
+        {
+            data_.ScheduleMCURow(row);
+        }
+        return true;
+    }
+
+    void FinishScan()
+    {
+        if (!data_.full_frame || !scan_callback)
+        {
+            return;
+        }
+        data_.FinishFrame();
+        rendered_scan_ = data_.scan_cnt;
+        scan_callback(image_.View(), data_.scan_cnt - 1);
+    }
+
+    void FinishFrame()
+    {
+        SECTION_ERROR_IF(data_.scan_cnt == 0, "Wrong amount of ImageData sections.");
+        if (rendered_scan_ != data_.scan_cnt)
+        {
+            data_.FinishFrame();
+        }
+        ReportRows(data_.full_frame ? data_.out_height : data_.FinishedRows());
+        stage_ = Stage::Done;
+        data_.stats.Finish();
+    }
+
+    void ReportRows(size_t finished)
+    {
+        if (finished > reported_rows_ && rows_callback)
+        {
+            PixelView rows = image_.View();
+            rows.data      = image_.Row(reported_rows_);
+            rows.height    = finished - reported_rows_;
+            rows_callback(rows, reported_rows_);
+        }
+        reported_rows_ = std::max(reported_rows_, finished);
+    }
+
+    // Drops the consumed data, the entropy reader continues from its position.
+    void Compact()
+    {
+        size_t consumed = pos_;
+        if (reader_)
+        {
+            consumed += reader_->Position();
+            reader_->Resume(StreamNavigator(std::span<const uint8_t>()));
+        }
+        buffer_.erase(buffer_.begin(), buffer_.begin() + consumed);
+        retry_size_ = retry_size_ > consumed ? retry_size_ - consumed : 0;
+        pos_        = 0;
+    }
+
+    std::vector<uint8_t>     buffer_;
+    // Offset of the next marker or of the entropy coded data not read yet.
+    size_t                   pos_      = 0;
+    Stage                    stage_    = Stage::Markers;
+    bool                     finished_ = false;
+    bool                     has_info_ = false;
+    OutputInfo               info_;
+    size_t                   next_row_  = 0;
+    // Entropy coded bytes of the last row read, a failed row is retried once
+    // the data grows by half of it.
+    size_t                   row_bytes_  = 0;
+    size_t                   retry_size_ = 0;
+    size_t                   reported_rows_ = 0;
+    size_t                   rendered_scan_ = 0;
+    std::vector<int16_t>     saved_blocks_;
+    // Frame header segment waiting for the first scan.
+    std::vector<uint8_t>     frame_segment_;
+    Image                    image_;
+    // Declared after the image to finish rows writing to it first.
+    DecoderData              data_;
+    std::optional<MCUReader> reader_;
+};
+
+//___StreamingDecoder__________________________________________________________________________________________________________
+
+StreamingDecoder::StreamingDecoder(const DecodeOptions& options) : impl_(std::make_unique<Impl>(options)) {}
+
+StreamingDecoder::~StreamingDecoder() = default;
+
+void StreamingDecoder::SetRowsCallback(RowsCallback callback) { impl_->rows_callback = std::move(callback); }
+
+void StreamingDecoder::SetScanCallback(ScanCallback callback) { impl_->scan_callback = std::move(callback); }
+
+void StreamingDecoder::Feed(std::span<const uint8_t> chunk) { impl_->Feed(chunk); }
+
+void StreamingDecoder::Finish() { impl_->Finish(); }
+
+bool StreamingDecoder::HasInfo() const { return impl_->HasInfo(); }
+
+const OutputInfo& StreamingDecoder::Info() const { return impl_->Info(); }
+
+bool StreamingDecoder::Done() const { return impl_->Done(); }
+
+Image StreamingDecoder::TakeImage() { return impl_->TakeImage(); }
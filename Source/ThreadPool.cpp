@@ -0,0 +1,181 @@
+#include "ThreadPool.h"
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Pool and queue of the worker running on this thread.
+thread_local ThreadPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+void PinThread(std::thread& thread, size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options) {
+    size_t threads = options.threads;
+    if (options.inline_only) {
+        threads = 0;
+    } else if (threads == 0) {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+        if (!options.affinity.empty()) {
+            PinThread(workers_.back(), options.affinity[i % options.affinity.size()]);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Default() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Queue::PushBack(Task task) {
+    if (size == slots.size()) {
+        // Unwraps the ring into twice as many slots.
+        std::vector<Task> grown(slots.size() * 2);
+        for (size_t i = 0; i < size; ++i) {
+            grown[i] = std::move(slots[(head + i) % slots.size()]);
+        }
+        slots = std::move(grown);
+        head = 0;
+    }
+    slots[(head + size++) % slots.size()] = std::move(task);
+}
+
+Task ThreadPool::Queue::PopBack() {
+    return std::move(slots[(head + --size) % slots.size()]);
+}
+
+Task ThreadPool::Queue::PopFront() {
+    Task task = std::move(slots[head]);
+    head = (head + 1) % slots.size();
+    --size;
+    return task;
+}
+
+void ThreadPool::Submit(Task task) {
+    // Workers keep tasks they spawn, others spread them over the queues.
+    size_t id = current_pool == this ? current_queue : next_queue_++ % queues_.size();
+    {
+        // Counted before the lock publishes the task, so its pop cannot take
+        // the count below zero.
+        std::lock_guard lock(queues_[id]->mutex);
+        queues_[id]->PushBack(std::move(task));
+        ++queued_;
+    }
+    {
+        // Sleeping workers check the count under this lock, taking it keeps
+        // them from missing the wake.
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::RunPending() {
+    if (queued_ == 0) {
+        return false;
+    }
+    Task task;
+    bool own = current_pool == this;
+    size_t first = own ? current_queue : next_queue_.load();
+    for (size_t i = 0; i < queues_.size() && !task; ++i) {
+        auto& queue = *queues_[(first + i) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.size == 0) {
+            continue;
+        }
+        task = own && i == 0 ? queue.PopBack() : queue.PopFront();
+        --queued_;
+    }
+    if (!task) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t id) {
+    current_pool = this;
+    current_queue = id;
+    while (true) {
+        if (RunPending()) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool_(pool) {
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        Wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::Finish() {
+    std::lock_guard lock(mutex_);
+    if (--pending_ == 0) {
+        done_.notify_all();
+    }
+}
+
+void TaskGroup::Wait() {
+    while (pending_ != 0) {
+        if (pool_.RunPending()) {
+            continue;
+        }
+        // Tasks of the group are running elsewhere, new ones may still be queued by them.
+        std::unique_lock lock(mutex_);
+        done_.wait_for(lock, std::chrono::microseconds(100), [this]() { return pending_ == 0; });
+    }
+    // Last task may still hold the lock after it notified.
+    std::lock_guard lock(mutex_);
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void TaskGroup::SetError(std::exception_ptr error) {
+    std::lock_guard lock(mutex_);
+    if (!error_) {
+        error_ = std::move(error);
+    }
+}
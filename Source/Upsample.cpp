@@ -0,0 +1,53 @@
+#include "Upsample.h"
+
+void UpsampleH2(const uint8_t* input, uint8_t* output, size_t width) {
+    for (size_t x = 0; x < width; ++x) {
+        output[2 * x] = input[x];
+        output[2 * x + 1] = input[x];
+    }
+}
+
+// Every output sample is 3/4 of the nearest input one and 1/4 of the next nearest,
+// rounding alternates between halves to avoid a bias.
+void UpsampleH2Fancy(const uint8_t* input, uint8_t* output, size_t width) {
+    output[0] = input[0];
+    output[1] = (input[0] * 3 + input[1] + 2) >> 2;
+    for (size_t x = 1; x + 1 < width; ++x) {
+        int value = input[x] * 3;
+        output[2 * x] = (value + input[x - 1] + 1) >> 2;
+        output[2 * x + 1] = (value + input[x + 1] + 2) >> 2;
+    }
+    size_t last = width - 1;
+    output[2 * last] = (input[last] * 3 + input[last - 1] + 1) >> 2;
+    output[2 * last + 1] = input[last];
+}
+
+// Vertical pass first, then horizontal one with the sums scaled by 16 in total.
+void UpsampleH2V2Fancy(const uint8_t* nearest, const uint8_t* farthest, uint8_t* output,
+                       size_t width) {
+    int last = 0;
+    int current = nearest[0] * 3 + farthest[0];
+    int next = nearest[1] * 3 + farthest[1];
+    output[0] = (current * 4 + 8) >> 4;
+    output[1] = (current * 3 + next + 7) >> 4;
+    for (size_t x = 1; x + 1 < width; ++x) {
+        last = current;
+        current = next;
+        next = nearest[x + 1] * 3 + farthest[x + 1];
+        output[2 * x] = (current * 3 + last + 8) >> 4;
+        output[2 * x + 1] = (current * 3 + next + 7) >> 4;
+    }
+    size_t end = width - 1;
+    last = current;
+    current = next;
+    output[2 * end] = (current * 3 + last + 8) >> 4;
+    output[2 * end + 1] = (current * 4 + 7) >> 4;
+}
+
+void UpsampleV2Fancy(const uint8_t* nearest, const uint8_t* farthest, uint8_t* output,
+                     size_t width, bool lower) {
+    int bias = lower ? 2 : 1;
+    for (size_t x = 0; x < width; ++x) {
+        output[x] = (nearest[x] * 3 + farthest[x] + bias) >> 2;
+    }
+}
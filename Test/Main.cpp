@@ -1,9 +1,44 @@
 #include "Decoder.h"
+#include "StreamingDecoder.h"
+#include "BatchDecoder.h"
+#include "ThreadPool.h"
+#include "DecodeStats.h"
 #include <jpeglib.h>
 
 const std::string kBasePath = IMAGE_DIR;
 
-Image ReadJpg(const std::string& filename)
+// Heap allocations of the process, counted to check decoders which reuse their memory.
+std::atomic<size_t> heap_allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++heap_allocations;
+    if (void* data = std::malloc(size ? size : 1))
+    {
+        return data;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    ++heap_allocations;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* data = std::aligned_alloc(align, (size + align - 1) / align * align))
+    {
+        return data;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept { std::free(data); }
+void operator delete(void* data, size_t) noexcept { std::free(data); }
+void operator delete(void* data, std::align_val_t) noexcept { std::free(data); }
+void operator delete(void* data, size_t, std::align_val_t) noexcept { std::free(data); }
+
+// Decodes the reference image with libjpeg's defaults, the islow IDCT among
+// them, at the scale and upsampling of |options|.
+Image ReadJpg(const std::string& filename, const DecodeOptions& options = {})
 {
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr         err;
@@ -19,6 +54,9 @@ Image ReadJpg(const std::string& filename)
     jpeg_stdio_src(&cinfo, infile);
 
     (void)jpeg_read_header(&cinfo, static_cast<boolean>(true));
+    cinfo.scale_num   = 1;
+    cinfo.scale_denom         = static_cast<unsigned int>(options.scale);
+    cinfo.do_fancy_upsampling = static_cast<boolean>(options.upsampling == UpsamplingMode::Fancy);
     (void)jpeg_start_decompress(&cinfo);
 
     int        row_stride = cinfo.output_width * cinfo.output_components;
@@ -54,12 +92,44 @@ Image ReadJpg(const std::string& filename)
     return result;
 }
 
+// Checks that |info| agrees with the headers libjpeg reads.
+bool CheckProbeInfo(const std::string& filename, const ProbeInfo& info)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr         err;
+    FILE*                         infile = fopen(filename.c_str(), "rb");
+
+    if (!infile)
+    {
+        throw std::runtime_error("can't open " + filename);
+    }
+
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, infile);
+    (void)jpeg_read_header(&cinfo, static_cast<boolean>(true));
+
+    bool same = info.width == cinfo.image_width && info.height == cinfo.image_height &&
+                info.components == static_cast<size_t>(cinfo.num_components) &&
+                info.progressive == static_cast<bool>(cinfo.progressive_mode);
+    for (size_t i = 0; same && i < info.components; ++i)
+    {
+        same = info.sampling[i].horizontal == static_cast<size_t>(cinfo.comp_info[i].h_samp_factor) &&
+               info.sampling[i].vertical == static_cast<size_t>(cinfo.comp_info[i].v_samp_factor);
+    }
+
+    jpeg_destroy_decompress(&cinfo);
+    fclose(infile);
+    return same;
+}
+
 double Distance(const RGB& lhs, const RGB& rhs)
 {
     return sqrt((lhs.r - rhs.r) * (lhs.r - rhs.r) + (lhs.g - rhs.g) * (lhs.g - rhs.g) + (lhs.b - rhs.b) * (lhs.b - rhs.b));
 }
 
-bool Compare(const Image& actual, const Image& expected)
+// An |exact| comparison fails on any differing pixel, others on a mean distance above 5.
+bool Compare(const Image& actual, const Image& expected, bool exact)
 {
     double max  = 0;
     double mean = 0;
@@ -74,6 +144,10 @@ bool Compare(const Image& actual, const Image& expected)
             auto actual_data   = actual.GetPixel(y, x);
             auto expected_data = expected.GetPixel(y, x);
             auto diff          = Distance(actual_data, expected_data);
+            if (exact && diff != 0)
+            {
+                return false;
+            }
             max                = std::max(max, diff);
             mean += diff;
         }
@@ -83,24 +157,345 @@ bool Compare(const Image& actual, const Image& expected)
     return mean <= 5;
 }
 
-bool CheckImage(const std::string& filename, const std::string& expected_comment = "")
+Image Crop(const Image& image, const Region& region)
+{
+    Image  result(region.width, region.height, image.Format());
+    size_t pixel = BytesPerPixel(image.Format());
+    for (size_t y = 0; y < region.height; ++y)
+    {
+        std::memcpy(result.Row(y), image.Row(region.y + y) + region.x * pixel, region.width * pixel);
+    }
+    return result;
+}
+
+enum class Api
+{
+    Stream,
+    File,
+    Into,
+    Chunks,
+    Probe,
+    Context,
+    Batch,
+    Allocations,
+    Stats,
+    Pipe,
+    Corrupt,
+    CorruptContext
+};
+
+// Decodes into a buffer with a stride that is not a multiple of the pixel size.
+Image DecodeIntoBuffer(std::istream& input, const DecodeOptions& options)
+{
+    std::streampos begin = input.tellg();
+    OutputInfo     info  = ReadOutputInfo(input, options);
+    if (input.tellg() != begin)
+    {
+        throw std::logic_error("Stream was not rewound after reading output info");
+    }
+    size_t     stride = info.MinStride() + 13;
+    auto       buffer = Image::Allocate(info.RequiredSize(stride));
+    DecodeInto(input, {buffer.get(), info.width, info.height, stride, info.format}, options);
+
+    Image image;
+    image.Adopt(std::move(buffer), info.width, info.height, stride, info.format);
+    image.SetComment(info.comment);
+    return image;
+}
+
+// Stream buffer over the data which, like one of a pipe, can not seek.
+class PipeBuffer : public std::streambuf
+{
+public:
+    explicit PipeBuffer(std::vector<char>& data) { setg(data.data(), data.data(), data.data() + data.size()); }
+};
+
+// Output info of a stream which can not be rewound has to be refused before
+// anything is read, so the image can still be decoded from it.
+Image DecodeFromPipe(std::istream& input, const DecodeOptions& options)
+{
+    std::vector<char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    PipeBuffer        buffer(data);
+    std::istream      pipe(&buffer);
+    bool              refused = false;
+    try
+    {
+        ReadOutputInfo(pipe, options);
+    } catch (const std::invalid_argument&)
+    {
+        refused = true;
+    }
+    if (!refused)
+    {
+        throw std::logic_error("Output info was read from a stream which can not be rewound");
+    }
+    return Decode(pipe, options);
+}
+
+// Zeroes a part of the scan at a few places, so each decode fails after some
+// rows were scheduled. They must be done before the image they write to is freed.
+Image DecodeAfterCorruption(std::istream& input, const DecodeOptions& options)
+{
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    for (size_t tenth = 4; tenth <= 7; ++tenth)
+    {
+        std::vector<uint8_t> corrupted = data;
+        std::fill_n(corrupted.begin() + corrupted.size() * tenth / 10, 64, 0);
+        try
+        {
+            Decode(corrupted, options);
+        } catch (const std::exception&)
+        {
+            continue;
+        }
+        throw std::logic_error("Corrupted image was decoded");
+    }
+    return Decode(data, options);
+}
+
+// Fails decodes into the view with a context first, the view must not change
+// after an error is thrown. The context is then reused for the intact image.
+Image DecodeWithContextAfterCorruption(std::istream& input, const DecodeOptions& options)
+{
+    DecoderContext       context;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    OutputInfo           info = context.ReadOutputInfo(data, options);
+    Image                image(info.width, info.height, info.format);
+    size_t               row_size = info.width * BytesPerPixel(info.format);
+    for (size_t tenth = 4; tenth <= 7; ++tenth)
+    {
+        std::vector<uint8_t> corrupted = data;
+        std::fill_n(corrupted.begin() + corrupted.size() * tenth / 10, 64, 0);
+        bool failed = false;
+        try
+        {
+            context.DecodeInto(corrupted, image.View(), options);
+        } catch (const std::exception&)
+        {
+            failed = true;
+        }
+        if (!failed)
+        {
+            throw std::logic_error("Corrupted image was decoded");
+        }
+        for (size_t y = 0; y < info.height; ++y)
+        {
+            std::memset(image.Row(y), 0x5a, row_size);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        for (size_t y = 0; y < info.height; ++y)
+        {
+            if (std::any_of(image.Row(y), image.Row(y) + row_size, [](uint8_t value) { return value != 0x5a; }))
+            {
+                throw std::logic_error("Output was written after the decode failed");
+            }
+        }
+    }
+    context.DecodeInto(data, image.View(), options);
+    image.SetComment(info.comment);
+    return image;
+}
+
+// Probes the headers first, the image has to match what they tell.
+Image DecodeAfterProbe(std::istream& input, const std::string& filename, const DecodeOptions& options)
+{
+    ProbeInfo info = Probe(input);
+    if (!CheckProbeInfo(filename, info))
+    {
+        throw std::logic_error("Probe does not match the headers");
+    }
+    input.seekg(0);
+    Image image = Decode(input, options);
+    if (image.Width() != info.width || image.Height() != info.height || image.GetComment() != info.comment)
+    {
+        throw std::logic_error("Probe does not match the image");
+    }
+    return image;
+}
+
+// Shares a context by all images decoded with it, so each one reuses buffers of another.
+Image DecodeWithContext(std::istream& input, const DecodeOptions& options)
+{
+    static DecoderContext context;
+    std::vector<uint8_t>  data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    return context.Decode(data, options);
+}
+
+// Decodes the image a few times with one context, the last decode must neither
+// touch the heap nor count an allocation of the context.
+Image DecodeWithoutAllocations(std::istream& input, const DecodeOptions& options)
+{
+    DecoderContext       context;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    OutputInfo           info = context.ReadOutputInfo(data, options);
+    Image                image(info.width, info.height, info.format);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        context.DecodeInto(data, image.View(), options);
+    }
+    size_t before         = heap_allocations;
+    size_t context_before = context.HeapAllocations();
+    context.DecodeInto(data, image.View(), options);
+    if (heap_allocations != before)
+    {
+        throw std::logic_error("Decode after warm-up allocated " + std::to_string(heap_allocations - before) + " times");
+    }
+    if (context_before == 0 || context.HeapAllocations() != context_before)
+    {
+        throw std::logic_error("Context counted " + std::to_string(context.HeapAllocations()) + " allocations, " +
+                               std::to_string(context_before) + " after warm-up");
+    }
+    image.SetComment(info.comment);
+    return image;
+}
+
+// Decodes with stats, which have to add up. A baseline image decoded whole has
+// each of its MCUs read once.
+Image DecodeWithStats(std::istream& input, const DecodeOptions& options)
+{
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    DecodeStats          stats;
+    DecodeOptions        stats_options = options;
+    stats_options.stats                = &stats;
+    Image                image         = Decode(data, stats_options);
+    ProbeInfo            info          = Probe(data);
+
+    auto check = [](bool condition, const std::string& message) {
+        if (!condition)
+        {
+            throw std::logic_error("Stats: " + message);
+        }
+    };
+    check(stats.bytes_consumed > 0 && stats.bytes_consumed <= data.size(), "bytes consumed");
+    check(stats.blocks >= stats.mcus && stats.mcus > 0 && stats.eob_blocks <= stats.blocks, "counters");
+    check(stats.peak_coefficient_bytes > 0 && stats.peak_pixel_bytes > 0, "memory");
+    if (!info.progressive && options.region.Empty())
+    {
+        size_t h_max = 0, v_max = 0, blocks_per_mcu = 0;
+        for (size_t i = 0; i < info.components; ++i)
+        {
+            h_max = std::max(h_max, info.sampling[i].horizontal);
+            v_max = std::max(v_max, info.sampling[i].vertical);
+            blocks_per_mcu += info.sampling[i].horizontal * info.sampling[i].vertical;
+        }
+        size_t mcus = ((info.width + 8 * h_max - 1) / (8 * h_max)) * ((info.height + 8 * v_max - 1) / (8 * v_max));
+        check(stats.mcus == mcus && stats.blocks == mcus * blocks_per_mcu, "MCUs of a baseline image");
+    }
+    std::array<uint64_t, kDecodeStageCount> event_ns = {};
+    for (const auto& event : stats.events)
+    {
+        check(event.begin_ns + event.duration_ns <= stats.total_ns, "event outside of the decode");
+        event_ns[static_cast<size_t>(event.stage)] += event.duration_ns;
+    }
+    check(event_ns == stats.stage_ns, "events do not sum to stages");
+    for (auto stage : {DecodeStage::MarkerScan, DecodeStage::EntropyDecode, DecodeStage::IDCT, DecodeStage::ColorConvert})
+    {
+        check(stats.StageNs(stage) > 0, DecodeStageToString(stage) + " is not timed");
+    }
+    check(stats.ChromeTrace().starts_with("{\"traceEvents\":["), "trace");
+    return image;
+}
+
+// Decodes a few copies of the image in a batch, through futures and through a callback.
+Image DecodeInBatch(std::istream& input, const DecodeOptions& options)
+{
+    std::vector<uint8_t>                  data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    std::vector<std::span<const uint8_t>> inputs(8, data);
+    BatchDecoder                          batch;
+    auto                                  futures = batch.Decode(inputs, options);
+    std::vector<Image>                    images(inputs.size());
+    batch.Decode(inputs, options, [&](size_t index, Image image, std::exception_ptr error) {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        images[index] = std::move(image);
+    });
+    batch.Wait();
+    Image result = images[0];
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        Image image = futures[i].get();
+        for (const Image* other : {&image, &images[i]})
+        {
+            for (size_t y = 0; y < result.Height(); ++y)
+            {
+                if (other->Width() != result.Width() || other->Height() != result.Height() ||
+                    std::memcmp(other->Row(y), result.Row(y), result.Width() * BytesPerPixel(result.Format())))
+                {
+                    throw std::logic_error("Images of a batch differ");
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Feeds the stream in small chunks, finished rows have to come in order.
+Image DecodeInChunks(std::istream& input, const DecodeOptions& options)
+{
+    StreamingDecoder decoder(options);
+    size_t           next_row = 0;
+    decoder.SetRowsCallback([&](const PixelView& rows, size_t first_row) {
+        if (first_row != next_row)
+        {
+            throw std::logic_error("Rows are out of order");
+        }
+        next_row += rows.height;
+    });
+    std::vector<char> chunk(1000);
+    while (input)
+    {
+        input.read(chunk.data(), chunk.size());
+        decoder.Feed({reinterpret_cast<const uint8_t*>(chunk.data()), static_cast<size_t>(input.gcount())});
+    }
+    decoder.Finish();
+    if (next_row != decoder.Info().height)
+    {
+        throw std::logic_error("Not all rows were reported");
+    }
+    return decoder.TakeImage();
+}
+
+bool CheckImage(const std::string& filename, const std::string& expected_comment = "", const DecodeOptions& options = {},
+                Api api = Api::Stream)
 {
     std::ifstream fin(kBasePath + filename);
     if (!fin.is_open())
     {
         throw std::invalid_argument("Cannot open a file");
     }
-    auto image = Decode(fin);
+    Image image;
+    switch (api)
+    {
+        case Api::Stream: image = Decode(fin, options); break;
+        case Api::File: image = DecodeFile(kBasePath + filename, options); break;
+        case Api::Into: image = DecodeIntoBuffer(fin, options); break;
+        case Api::Chunks: image = DecodeInChunks(fin, options); break;
+        case Api::Probe: image = DecodeAfterProbe(fin, kBasePath + filename, options); break;
+        case Api::Context: image = DecodeWithContext(fin, options); break;
+        case Api::Batch: image = DecodeInBatch(fin, options); break;
+        case Api::Allocations: image = DecodeWithoutAllocations(fin, options); break;
+        case Api::Stats: image = DecodeWithStats(fin, options); break;
+        case Api::Pipe: image = DecodeFromPipe(fin, options); break;
+        case Api::Corrupt: image = DecodeAfterCorruption(fin, options); break;
+        case Api::CorruptContext: image = DecodeWithContextAfterCorruption(fin, options); break;
+    }
     fin.close();
     if (image.GetComment() != expected_comment)
     {
         return false;
     }
-    auto ok_image = ReadJpg(kBasePath + filename);
-    return Compare(image, ok_image);
+    auto ok_image = ReadJpg(kBasePath + filename, options);
+    if (!options.region.Empty())
+    {
+        ok_image = Crop(ok_image, options.region);
+    }
+    return Compare(image, ok_image, IsBitExact(options.idct));
 }
 
-bool TestImage(const std::string& filename, const std::string& expected_comment = "", bool expect_error = false)
+bool TestImage(const std::string& filename, const std::string& expected_comment = "", bool expect_error = false,
+               const DecodeOptions& options = {}, Api api = Api::Stream)
 {
     std::chrono::steady_clock::time_point begin, end;
     bool                                  result;
@@ -108,7 +503,7 @@ bool TestImage(const std::string& filename, const std::string& expected_comment
     begin                                       = std::chrono::steady_clock::now();
     try
     {
-        if (!CheckImage(filename, expected_comment))
+        if (!CheckImage(filename, expected_comment, options, api))
         {
             throw std::logic_error("Decoded image is not same as expected");
         }
@@ -134,13 +529,17 @@ bool TestImage(const std::string& filename, const std::string& expected_comment
 
 struct TestCase
 {
-    std::string file;
-    std::string expected_comment = "";
-    bool        expect_error     = false;
+    std::string   file;
+    std::string   expected_comment = "";
+    bool          expect_error     = false;
+    DecodeOptions options          = {};
+    Api           api              = Api::Stream;
 };
 
 int main()
 {
+    ThreadPool            pool(ThreadPoolOptions::Threads(3));
+    ThreadPool            inline_pool(ThreadPoolOptions::Inline());
     std::vector<TestCase> test_cases = {
         {        "small.jpg",         ":)"},
         {        "lenna.jpg",           ""},
@@ -155,26 +554,95 @@ int main()
         { "architecture.jpg",           ""},
         {        "witch.jpg",           ""},
         {         "huge.jpg",           ""},
+        {      "restart.jpg",           ""},
+        {  "progressive.jpg",           ""},
+        {"progressive-2.jpg", "such decoder"},
+        {"progressive_small.jpg",       ""},
+        {      "restart.jpg",           "", false, {.parallel_restart_intervals = true}},
+        {      "restart.jpg",           "", false, {.parallel_restart_intervals = true, .thread_pool = &pool}},
+        {        "witch.jpg",           "", false, {.thread_pool = &pool}},
+        {        "lenna.jpg",           "", false, {.thread_pool = &inline_pool}},
+        {  "progressive.jpg",           "", false, {.thread_pool = &pool}},
+        {        "lenna.jpg",           "", false, {.pixel_format = PixelFormat::BGR8}},
+        {        "small.jpg",         ":)", false, {.pixel_format = PixelFormat::RGBA8}},
+        {    "grayscale.jpg",           "", false, {.pixel_format = PixelFormat::Gray8}},
+        {"chroma_halfed.jpg",           "", false, {.upsampling = UpsamplingMode::Nearest}},
+        {        "witch.jpg",           "", false, {.pixel_format = PixelFormat::BGR8, .upsampling = UpsamplingMode::Nearest}},
+        {        "small.jpg",         ":)", false,                                          {},   Api::Into},
+        {        "witch.jpg",           "", false,   {.pixel_format = PixelFormat::RGBA8},   Api::Into},
+        {        "lenna.jpg",           "", false,                                          {},   Api::File},
+        {      "restart.jpg",           "", false,                                          {},   Api::File},
+        {        "lenna.jpg",           "", false,                                          {}, Api::Chunks},
+        {        "lenna.jpg",           "", false, {.scale = DecodeScale::Half}},
+        {"chroma_halfed.jpg",           "", false, {.scale = DecodeScale::Quarter}},
+        {  "progressive.jpg",           "", false, {.scale = DecodeScale::Eighth}},
+        {        "witch.jpg",           "", false, {.pixel_format = PixelFormat::RGBA8, .scale = DecodeScale::Eighth}, Api::Into},
+        {      "restart.jpg",           "", false,                                          {}, Api::Chunks},
+        {"progressive-2.jpg", "such decoder", false,                                        {}, Api::Chunks},
+        {"dqt_after_frame.jpg",         "", false,                                          {}},
+        {"dqt_after_frame.jpg",         "", false,                                          {}, Api::Chunks},
+        {        "lenna.jpg",           "", false, {.region = {100, 200, 150, 60}}},
+        {      "restart.jpg",           "", false, {.region = {217, 150, 90, 33}}},
+        {      "restart.jpg",           "", false, {.region = {5, 300, 470, 49}, .parallel_restart_intervals = true}},
+        {  "progressive.jpg",           "", false, {.region = {0, 7, 420, 1}}},
+        {"chroma_halfed.jpg",           "", false, {.scale = DecodeScale::Half, .region = {301, 77, 99, 101}}},
+        {        "witch.jpg",           "", false, {.pixel_format = PixelFormat::RGBA8, .region = {333, 666, 1, 1}}, Api::Into},
+        {      "restart.jpg",           "", false, {.region = {17, 21, 200, 300}}, Api::Chunks},
+        {        "small.jpg",         ":)", false,                                          {},  Api::Probe},
+        {"chroma_halfed.jpg",           "", false,                                          {},  Api::Probe},
+        {    "grayscale.jpg",           "", false,                                          {},  Api::Probe},
+        {"progressive-2.jpg", "such decoder", false,                                        {},  Api::Probe},
+        {        "lenna.jpg",           "", false,                                          {}, Api::Context},
+        {  "progressive.jpg",           "", false,                                          {}, Api::Context},
+        {"chroma_halfed.jpg",           "", false,                                          {}, Api::Context},
+        {      "restart.jpg",           "", false, {.scale = DecodeScale::Half},                Api::Context},
+        {        "small.jpg",         ":)", false,                                          {}, Api::Context},
+        {    "grayscale.jpg",           "", false,                                          {}, Api::Batch},
+        {"progressive_small.jpg",       "", false,                                          {}, Api::Batch},
+        {        "witch.jpg",           "", false, {.region = {100, 100, 300, 200}},             Api::Batch},
+        {        "lenna.jpg",           "", false, {.thread_pool = &inline_pool},           Api::Allocations},
+        {"progressive-2.jpg", "such decoder", false, {.thread_pool = &inline_pool},         Api::Allocations},
+        {      "restart.jpg",           "", false, {.region = {50, 50, 100, 100}, .thread_pool = &inline_pool}, Api::Allocations},
+        {        "lenna.jpg",           "", false, {.thread_pool = &pool},                  Api::Allocations},
+        {"progressive-2.jpg", "such decoder", false, {.thread_pool = &pool},                Api::Allocations},
+        {      "restart.jpg",           "", false, {.parallel_restart_intervals = true, .thread_pool = &pool}, Api::Allocations},
+        {        "lenna.jpg",           "", false,                                          {},  Api::Stats},
+        {"progressive-2.jpg", "such decoder", false, {.thread_pool = &pool},                   Api::Stats},
+        {      "restart.jpg",           "", false, {.region = {5, 30, 400, 200}, .parallel_restart_intervals = true}, Api::Stats},
+        {        "lenna.jpg",           "", false,                                          {},   Api::Pipe},
+        {"progressive-2.jpg", "such decoder", false,                                        {},   Api::Pipe},
+        {        "lenna.jpg",           "", false, {.thread_pool = &pool},                  Api::Corrupt},
+        {      "restart.jpg",           "", false, {.thread_pool = &pool},                  Api::Corrupt},
+        {        "lenna.jpg",           "", false, {.thread_pool = &pool},                  Api::CorruptContext},
+        {      "restart.jpg",           "", false, {.thread_pool = &pool},                  Api::CorruptContext},
     };
     const size_t tests_count = 24;
     for (size_t i = 1; i <= tests_count; ++i)
     {
         test_cases.push_back({"bad" + std::to_string(i) + ".jpg", "", true});
     }
-    int failed = 0;
-    for (const auto& test_case : test_cases)
+    int    failed = 0;
+    size_t total  = 0;
+    for (auto backend : AvailableIDCTBackends())
     {
-        if (!TestImage(test_case.file, test_case.expected_comment, test_case.expect_error))
+        std::cout << "IDCT backend: " << IDCTBackendTypeToString(backend) << std::endl;
+        for (auto test_case : test_cases)
         {
-            ++failed;
+            test_case.options.idct = backend;
+            if (!TestImage(test_case.file, test_case.expected_comment, test_case.expect_error, test_case.options,
+                           test_case.api))
+            {
+                ++failed;
+            }
+            ++total;
         }
     }
     if (failed)
     {
-        std::cout << failed << "/" << test_cases.size() << " test cases failed" << std::endl;
+        std::cout << failed << "/" << total << " test cases failed" << std::endl;
     }
     else
     {
-        std::cout << "All " << test_cases.size() << " test cases passed" << std::endl;
+        std::cout << "All " << total << " test cases passed" << std::endl;
     }
 }